@@ -0,0 +1,306 @@
+//===- IRGenerator.cpp - Synthetic IR for the CSE 231 benchmarks ---------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Generates modules that stress the CSE 231 analyses: how large functions
+// are, how deeply their loops nest, how many values merge in phis, how much
+// of the code goes through pointers, how many globals there are and the
+// shape of the call graph are all parameters. The same seed always gives
+// the same module.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/ToolOutputFile.h"
+#include "llvm/Support/WithColor.h"
+#include <random>
+#include <vector>
+
+using namespace llvm;
+
+enum CallShape { ChainCalls, TreeCalls, RandomCalls, RecursiveCalls };
+
+static cl::opt<std::string> OutputFile("o", cl::init("-"), cl::desc("Output file, bitcode if it ends with .bc"), cl::value_desc("file"));
+static cl::opt<unsigned> NumFunctions("functions", cl::init(8), cl::desc("Number of functions"));
+static cl::opt<unsigned> NumBlocks("blocks", cl::init(40), cl::desc("Approximate number of basic blocks per function"));
+static cl::opt<unsigned> BlockSize("block-size", cl::init(6), cl::desc("Instructions generated per straight-line block"));
+static cl::opt<unsigned> LoopDepth("loop-depth", cl::init(2), cl::desc("Maximum loop nesting depth"));
+static cl::opt<unsigned> PhiPercent("phi-density", cl::init(30), cl::desc("Percentage of live values merged by a phi at each join"));
+static cl::opt<unsigned> PointerPercent("pointer-ratio", cl::init(30), cl::desc("Percentage of memory operations going through pointers"));
+static cl::opt<unsigned> NumGlobals("globals", cl::init(16), cl::desc("Number of global variables"));
+static cl::opt<unsigned> CallsPerFunction("calls", cl::init(2), cl::desc("Calls per function (random and recursive shapes)"));
+static cl::opt<CallShape> Shape("call-graph", cl::init(RandomCalls), cl::desc("Shape of the call graph"),
+    cl::values(clEnumValN(ChainCalls, "chain", "f<i> calls f<i+1>"),
+               clEnumValN(TreeCalls, "tree", "f<i> calls f<2i+1> and f<2i+2>"),
+               clEnumValN(RandomCalls, "random", "calls to random later functions (a DAG)"),
+               clEnumValN(RecursiveCalls, "recursive", "calls to random functions (cycles)")));
+static cl::opt<unsigned> Seed("seed", cl::init(1), cl::desc("Random seed"));
+
+namespace {
+
+class Generator {
+public:
+  Generator(Module &M) : M(M), Ctx(M.getContext()), Rand(Seed), Int32Ty(Type::getInt32Ty(Ctx)) {}
+
+  void run() {
+    PointerType *Int32PtrTy = Int32Ty->getPointerTo();
+    for (unsigned I = 0; I < NumGlobals; ++I)
+      Globals.push_back(new GlobalVariable(M, Int32Ty, false, GlobalValue::ExternalLinkage,
+                                           ConstantInt::get(Int32Ty, I), "g" + Twine(I)));
+    // A few globals start out pointing to others, as MPT sees them
+    for (unsigned I = 0; I < NumGlobals / 4; ++I)
+      PtrGlobals.push_back(new GlobalVariable(M, Int32PtrTy, false, GlobalValue::ExternalLinkage,
+                                              pick(Globals), "pg" + Twine(I)));
+
+    FunctionType *FTy = FunctionType::get(Int32Ty, {Int32Ty}, false);
+    for (unsigned I = 0; I < NumFunctions; ++I)
+      Functions.push_back(Function::Create(FTy, GlobalValue::ExternalLinkage, "f" + Twine(I), M));
+    for (unsigned I = 0; I < NumFunctions; ++I)
+      emitFunction(I);
+  }
+
+private:
+  unsigned roll(unsigned N) { return std::uniform_int_distribution<unsigned>(0, N - 1)(Rand); }
+  bool chance(unsigned Percent) { return roll(100) < Percent; }
+  template <class T> T *pick(const std::vector<T *> &From) { return From[roll(From.size())]; }
+
+  std::vector<Function *> getCallees(unsigned Index) {
+    std::vector<Function *> Callees;
+    switch (Shape) {
+    case ChainCalls:
+      if (Index + 1 < NumFunctions)
+        Callees.push_back(Functions[Index + 1]);
+      break;
+    case TreeCalls:
+      for (unsigned Child = 2 * Index + 1; Child <= 2 * Index + 2 && Child < NumFunctions; ++Child)
+        Callees.push_back(Functions[Child]);
+      break;
+    case RandomCalls:
+      for (unsigned I = 0; I < CallsPerFunction && Index + 1 < NumFunctions; ++I)
+        Callees.push_back(Functions[Index + 1 + roll(NumFunctions - Index - 1)]);
+      break;
+    case RecursiveCalls:
+      for (unsigned I = 0; I < CallsPerFunction; ++I)
+        Callees.push_back(pick(Functions));
+      break;
+    }
+    return Callees;
+  }
+
+  Value *operand() {
+    if (Live.empty() || chance(10))
+      return ConstantInt::get(Int32Ty, roll(16));
+    return Live[Live.size() - 1 - roll(std::min<size_t>(Live.size(), 8))];
+  }
+
+  // One instruction of straight-line code
+  void emitInstruction() {
+    unsigned Kind = roll(10);
+    if (Kind < 4) {
+      static const Instruction::BinaryOps Ops[] = {Instruction::Add, Instruction::Sub, Instruction::Mul, Instruction::Xor};
+      Live.push_back(B->CreateBinOp(Ops[roll(4)], operand(), operand()));
+    } else if (Kind < 6) {
+      Value *Ptr = memoryOperand();
+      Live.push_back(B->CreateLoad(Int32Ty, Ptr));
+    } else if (Kind < 8) {
+      B->CreateStore(operand(), memoryOperand());
+    } else if (Kind < 9 && !PtrSlots.empty()) {
+      // Retarget a pointer, to a global or a local slot
+      Value *Target = chance(50) ? (Value *)pick(Globals) : (Value *)pick(Slots);
+      B->CreateStore(Target, pick(chance(50) ? PtrSlots : PtrGlobalValues));
+    } else if (!Callees.empty()) {
+      Live.push_back(B->CreateCall(Callees.back(), {operand()}));
+      Callees.pop_back();
+    } else {
+      Live.push_back(B->CreateICmpSLT(operand(), operand()));
+      Live.back() = B->CreateZExt(Live.back(), Int32Ty);
+    }
+  }
+
+  Value *memoryOperand() {
+    if (chance(PointerPercent) && !PtrSlots.empty())
+      return B->CreateLoad(Int32Ty->getPointerTo(), pick(chance(70) ? PtrSlots : PtrGlobalValues));
+    return chance(50) ? (Value *)pick(Slots) : (Value *)pick(Globals);
+  }
+
+  BasicBlock *newBlock() {
+    ++BlockCount;
+    return BasicBlock::Create(Ctx, "", CurFn);
+  }
+
+  // Phis at Join for some of the values live before the split, fed by a
+  // value of each side that reaches its end
+  void mergeLive(BasicBlock *Join, size_t Before, ArrayRef<std::pair<BasicBlock *, std::vector<Value *>>> Sides) {
+    std::vector<Value *> Merged(Live.begin(), Live.begin() + Before);
+    B->SetInsertPoint(Join);
+    for (size_t I = 0; I < Before; ++I) {
+      if (!chance(PhiPercent))
+        continue;
+      PHINode *Phi = B->CreatePHI(Int32Ty, Sides.size());
+      for (auto &Side : Sides)
+        Phi->addIncoming(Side.second.empty() ? Live[I] : Side.second[roll(Side.second.size())], Side.first);
+      Merged.push_back(Phi);
+    }
+    Live = Merged;
+  }
+
+  void emitStraight() {
+    for (unsigned I = 0; I < BlockSize; ++I)
+      emitInstruction();
+  }
+
+  void emitDiamond(unsigned Depth) {
+    size_t Before = Live.size();
+    BasicBlock *Then = newBlock(), *Else = newBlock(), *Join = newBlock();
+    B->CreateCondBr(B->CreateICmpSGT(operand(), operand()), Then, Else);
+
+    std::vector<std::pair<BasicBlock *, std::vector<Value *>>> Sides;
+    for (BasicBlock *Side : {Then, Else}) {
+      B->SetInsertPoint(Side);
+      Live.resize(Before);
+      emitRegion(Depth, 2);
+      Sides.emplace_back(B->GetInsertBlock(), std::vector<Value *>(Live.begin() + Before, Live.end()));
+      B->CreateBr(Join);
+    }
+    Live.resize(Before);
+    mergeLive(Join, Before, Sides);
+  }
+
+  void emitLoop(unsigned Depth) {
+    BasicBlock *Pre = B->GetInsertBlock();
+    BasicBlock *Header = newBlock(), *Exit = newBlock();
+    B->CreateBr(Header);
+    B->SetInsertPoint(Header);
+    PHINode *IV = B->CreatePHI(Int32Ty, 2);
+    IV->addIncoming(B->getInt32(0), Pre);
+    // Loop carried values
+    size_t Before = Live.size();
+    std::vector<PHINode *> Carried;
+    for (size_t I = 0; I < Before; ++I) {
+      if (!chance(PhiPercent))
+        continue;
+      PHINode *Phi = B->CreatePHI(Int32Ty, 2);
+      Phi->addIncoming(Live[I], Pre);
+      Carried.push_back(Phi);
+    }
+    Live.insert(Live.end(), Carried.begin(), Carried.end());
+    Live.push_back(IV);
+
+    emitRegion(Depth + 1, 3);
+    Value *Next = B->CreateAdd(IV, B->getInt32(1));
+    IV->addIncoming(Next, B->GetInsertBlock());
+    for (PHINode *Phi : Carried)
+      Phi->addIncoming(operand(), B->GetInsertBlock());
+    B->CreateCondBr(B->CreateICmpSLT(Next, CurFn->getArg(0)), Header, Exit);
+    B->SetInsertPoint(Exit);
+    Live.resize(Before);
+    Live.insert(Live.end(), Carried.begin(), Carried.end());
+  }
+
+  // A sequence of straight code, diamonds and loops, up to Pieces of them
+  void emitRegion(unsigned Depth, unsigned Pieces) {
+    for (unsigned I = 0; I < Pieces && BlockCount < NumBlocks; ++I) {
+      unsigned Kind = roll(3);
+      if (Kind == 0 && Depth < LoopDepth)
+        emitLoop(Depth);
+      else if (Kind == 1)
+        emitDiamond(Depth);
+      else
+        emitStraight();
+    }
+    emitStraight();
+  }
+
+  void emitFunction(unsigned Index) {
+    CurFn = Functions[Index];
+    BlockCount = 0;
+    Live.clear();
+    Slots.clear();
+    PtrSlots.clear();
+    PtrGlobalValues.assign(PtrGlobals.begin(), PtrGlobals.end());
+    Callees = getCallees(Index);
+
+    IRBuilder<> Builder(BasicBlock::Create(Ctx, "entry", CurFn));
+    B = &Builder;
+    ++BlockCount;
+    for (unsigned I = 0; I < 4; ++I) {
+      Slots.push_back(B->CreateAlloca(Int32Ty));
+      B->CreateStore(B->getInt32(I), Slots.back());
+    }
+    for (unsigned I = 0; I < 2 && PointerPercent; ++I) {
+      PtrSlots.push_back(B->CreateAlloca(Int32Ty->getPointerTo()));
+      B->CreateStore(pick(Slots), PtrSlots.back());
+    }
+    if (PtrGlobalValues.empty())
+      PtrGlobalValues = PtrSlots;
+    Live.push_back(CurFn->getArg(0));
+
+    while (BlockCount < NumBlocks)
+      emitRegion(0, NumBlocks);
+    // Leftover calls of the call graph shape
+    while (!Callees.empty()) {
+      Live.push_back(B->CreateCall(Callees.back(), {operand()}));
+      Callees.pop_back();
+    }
+    B->CreateRet(operand());
+  }
+
+  Module &M;
+  LLVMContext &Ctx;
+  std::mt19937 Rand;
+  Type *Int32Ty;
+  std::vector<GlobalVariable *> Globals, PtrGlobals;
+  std::vector<Function *> Functions;
+
+  // State of the function being generated
+  Function *CurFn = nullptr;
+  IRBuilder<> *B = nullptr;
+  unsigned BlockCount = 0;
+  std::vector<Value *> Live;          // i32 values that dominate the insertion point
+  std::vector<Value *> Slots;         // i32 allocas
+  std::vector<Value *> PtrSlots;      // i32* allocas
+  std::vector<Value *> PtrGlobalValues;
+  std::vector<Function *> Callees;    // calls still to place
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+  InitLLVM X(argc, argv);
+  cl::ParseCommandLineOptions(argc, argv, "Synthetic IR generator for the CSE 231 benchmarks\n");
+  if (NumFunctions == 0 || NumGlobals == 0) {
+    WithColor::error(errs(), "cse231-irgen") << "need at least one function and one global\n";
+    return 1;
+  }
+
+  LLVMContext Ctx;
+  Module M("cse231-bench", Ctx);
+  Generator(M).run();
+  if (verifyModule(M, &errs()))
+    return 1;
+
+  std::error_code EC;
+  ToolOutputFile Out(OutputFile, EC, sys::fs::OF_None);
+  if (EC) {
+    WithColor::error(errs(), "cse231-irgen") << OutputFile << ": " << EC.message() << "\n";
+    return 1;
+  }
+  if (StringRef(OutputFile).endswith(".bc"))
+    WriteBitcodeToFile(M, Out.os());
+  else
+    M.print(Out.os(), nullptr);
+  Out.keep();
+  return 0;
+}
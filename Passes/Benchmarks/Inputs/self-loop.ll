@@ -0,0 +1,32 @@
+; A single-block loop: its back edge leaves the terminator of %loop and
+; enters the same block, so the block granularity solver must carry the
+; facts around it like any other block boundary edge.
+
+@g = global i32 0
+@h = global i32 0
+
+define i32 @count(i32 %n, i32* %p) {
+entry:
+  %a = alloca i32
+  %q = alloca i32*
+  store i32 0, i32* %a
+  store i32* %a, i32** %q
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %acc = phi i32 [ 1, %entry ], [ %sum, %loop ]
+  %v = load i32, i32* @g
+  %sum = add i32 %acc, %v
+  store i32 %sum, i32* @h
+  store i32* %p, i32** %q
+  store i32 5, i32* @g
+  %next = add i32 %i, 1
+  %c = icmp slt i32 %next, %n
+  br i1 %c, label %loop, label %exit
+
+exit:
+  %r = load i32, i32* @h
+  %s = add i32 %r, %sum
+  ret i32 %s
+}
@@ -0,0 +1,47 @@
+#!/usr/bin/env python3
+"""Check that -cse231-block-dfa does not change the results.
+
+Runs every cse231 dataflow analysis on each input module twice, at node and
+at basic block granularity, and reports the inputs whose outputs differ.
+"""
+
+import argparse
+import glob
+import os
+import subprocess
+import sys
+
+# name -> (plugin, opt flags)
+ANALYSES = {
+    'reaching': ('submission_pt2', ['-cse231-reaching']),
+    'liveness': ('submission_pt3', ['-cse231-liveness']),
+    'maypointto': ('submission_pt3', ['-cse231-maypointto']),
+    'constprop': ('submission_pt4', ['-cse231-constprop']),
+}
+
+
+def output(cmd):
+    return subprocess.run(cmd, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, check=True).stderr
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--opt', default='opt', help='opt binary')
+    parser.add_argument('--plugin-dir', required=True, help='directory of the submission_pt*.so plugins')
+    parser.add_argument('inputs', nargs='*', help='modules, by default the .ll files of Inputs/')
+    args = parser.parse_args()
+
+    inputs = args.inputs or sorted(glob.glob(os.path.join(os.path.dirname(os.path.abspath(__file__)), 'Inputs', '*.ll')))
+    failed = False
+    for module in inputs:
+        for name, (plugin, flags) in ANALYSES.items():
+            cmd = [args.opt, '-enable-new-pm=0', '-load', os.path.join(args.plugin_dir, plugin + '.so')] + flags + [
+                '-o', os.devnull, module]
+            same = output(cmd) == output(cmd + ['-cse231-block-dfa'])
+            failed |= not same
+            print('%-12s %s%s' % (name, os.path.basename(module), '' if same else '  DIFFERS'))
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+"""Scalability benchmarks of the CSE 231 analyses.
+
+Generates modules with cse231-irgen over a sweep of function sizes and call
+graph shapes, runs every cse231 analysis and a few LLVM analyses that solve
+the same problems as reference points, and writes one JSON record per run:
+wall time, peak RSS, worklist iterations (when opt was built with statistics)
+and output size.
+"""
+
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import time
+
+# name -> (plugin, opt flags)
+ANALYSES = {
+    'reaching': ('submission_pt2', ['-cse231-reaching']),
+    'liveness': ('submission_pt3', ['-cse231-liveness']),
+    'ssa-liveness': ('submission_pt3', ['-cse231-ssa-liveness']),
+    'maypointto': ('submission_pt3', ['-cse231-maypointto']),
+    'maypointto-andersen': ('submission_pt3', ['-cse231-maypointto', '-cse231-maypointto-solver=andersen']),
+    'constprop': ('submission_pt4', ['-cse231-constprop']),
+}
+
+# name -> command after the tool, the module is appended
+BASELINES = {
+    'llvm-sccp': ('opt', ['-passes=sccp', '-disable-output']),
+    'llvm-basic-aa': ('opt', ['-passes=aa-eval', '-aa-pipeline=basic-aa', '-disable-output']),
+    'llvm-livevars': ('llc', ['-O2', '-stop-after=livevars', '-o', os.devnull]),
+}
+
+STAT_RE = re.compile(r'^\s*(\d+)\s+\S+\s+-\s+Number of worklist iterations')
+
+
+def run(cmd, stderr_path):
+    """Run cmd with stderr to a file; return (seconds, peak RSS in KB, exit code)."""
+    with open(stderr_path, 'wb') as err:
+        start = time.monotonic()
+        proc = subprocess.Popen(cmd, stdout=subprocess.DEVNULL, stderr=err)
+        _, status, usage = os.wait4(proc.pid, 0)
+        elapsed = time.monotonic() - start
+    code = os.WEXITSTATUS(status) if os.WIFEXITED(status) else -os.WTERMSIG(status)
+    # ru_maxrss is in KB on Linux
+    return elapsed, usage.ru_maxrss, code
+
+
+def worklist_iterations(stderr_path):
+    total = None
+    with open(stderr_path, errors='replace') as err:
+        for line in err:
+            match = STAT_RE.match(line)
+            if match:
+                total = (total or 0) + int(match.group(1))
+    return total
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--opt', default='opt', help='opt binary')
+    parser.add_argument('--llc', default='llc', help='llc binary, for the LiveVariables baseline')
+    parser.add_argument('--irgen', required=True, help='cse231-irgen binary')
+    parser.add_argument('--plugin-dir', required=True, help='directory of the submission_pt*.so plugins')
+    parser.add_argument('--output', default='cse231-bench.json', help='JSON report')
+    parser.add_argument('--sizes', default='50,200,800', help='blocks per function to sweep')
+    parser.add_argument('--functions', type=int, default=16, help='functions per module')
+    parser.add_argument('--shapes', default='random,recursive', help='call graph shapes to sweep')
+    parser.add_argument('--loop-depth', type=int, default=2)
+    parser.add_argument('--phi-density', type=int, default=30)
+    parser.add_argument('--pointer-ratio', type=int, default=30)
+    parser.add_argument('--globals', type=int, default=32)
+    parser.add_argument('--seed', type=int, default=1)
+    parser.add_argument('--analyses', default=','.join(ANALYSES), help='cse231 analyses to run')
+    parser.add_argument('--no-baselines', action='store_true', help='skip the LLVM reference analyses')
+    parser.add_argument('--extra-args', default='', help='more opt flags for the cse231 analyses, e.g. -cse231-threads=4')
+    args = parser.parse_args()
+
+    tools = {'opt': args.opt, 'llc': args.llc}
+    records = []
+    failed = False
+    with tempfile.TemporaryDirectory(prefix='cse231-bench') as tmp:
+        stderr_path = os.path.join(tmp, 'stderr')
+        for shape in args.shapes.split(','):
+            for size in [int(s) for s in args.sizes.split(',')]:
+                params = {
+                    'blocks': size, 'functions': args.functions, 'call_graph': shape,
+                    'loop_depth': args.loop_depth, 'phi_density': args.phi_density,
+                    'pointer_ratio': args.pointer_ratio, 'globals': args.globals, 'seed': args.seed,
+                }
+                module = os.path.join(tmp, 'bench-%s-%d.bc' % (shape, size))
+                subprocess.check_call([
+                    args.irgen, '-o', module, '-blocks=%d' % size, '-functions=%d' % args.functions,
+                    '-call-graph=%s' % shape, '-loop-depth=%d' % args.loop_depth,
+                    '-phi-density=%d' % args.phi_density, '-pointer-ratio=%d' % args.pointer_ratio,
+                    '-globals=%d' % args.globals, '-seed=%d' % args.seed])
+
+                runs = []
+                for name in args.analyses.split(','):
+                    plugin, flags = ANALYSES[name]
+                    cmd = [args.opt, '-enable-new-pm=0', '-load',
+                           os.path.join(args.plugin_dir, plugin + '.so')] + flags + ['-stats',
+                           '-o', os.devnull, module] + args.extra_args.split()
+                    runs.append((name, cmd))
+                if not args.no_baselines:
+                    for name, (tool, flags) in BASELINES.items():
+                        runs.append((name, [tools[tool]] + flags + [module]))
+
+                for name, cmd in runs:
+                    seconds, rss, code = run(cmd, stderr_path)
+                    record = dict(params)
+                    record.update({
+                        'analysis': name,
+                        'wall_seconds': round(seconds, 4),
+                        'max_rss_kb': rss,
+                        'worklist_iterations': worklist_iterations(stderr_path),
+                        'output_bytes': os.path.getsize(stderr_path),
+                        'exit_code': code,
+                    })
+                    records.append(record)
+                    failed |= code != 0
+                    print('%-10s %-20s %6d blocks  %8.3fs  %8d KB%s' % (
+                        shape, name, size, seconds, rss, '' if code == 0 else '  FAILED (%d)' % code))
+
+    with open(args.output, 'w') as out:
+        json.dump({'benchmarks': records}, out, indent=1)
+    print('wrote', args.output)
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -1,3 +1,4 @@
+#include "EdgeProfile.h"
 #include "llvm/Pass.h"
 #include "llvm/IR/Function.h"
 #include "llvm/Support/raw_ostream.h"
@@ -5,19 +6,90 @@
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/GlobalVariable.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Transforms/Utils/ModuleUtils.h"
 #include <string>
 
 using namespace llvm;
 
+static cl::opt<bool> EdgeProfiling("cse231-bb-edge-profile", cl::init(false),
+    cl::desc("Only count the CFG edges off a maximum spanning tree and derive the branch counts at exit"));
+
 namespace{
+    /* call update(arg) the given number of times at the insertion point of Builder, which is left after the loop */
+    void emitCallLoop(IRBuilder<>& Builder, Value* times, FunctionCallee update, Value* arg){
+        Function* F=Builder.GetInsertBlock()->getParent();
+        BasicBlock* pre=Builder.GetInsertBlock();
+        BasicBlock* loop=BasicBlock::Create(F->getContext(),"loop",F);
+        BasicBlock* done=BasicBlock::Create(F->getContext(),"done",F);
+        Builder.CreateCondBr(Builder.CreateICmpSGT(times,Builder.getInt64(0)),loop,done);
+
+        Builder.SetInsertPoint(loop);
+        PHINode* i=Builder.CreatePHI(Builder.getInt64Ty(),2);
+        i->addIncoming(Builder.getInt64(0),pre);
+        Builder.CreateCall(update,{arg});
+        Value* next=Builder.CreateAdd(i,Builder.getInt64(1));
+        i->addIncoming(next,loop);
+        Builder.CreateCondBr(Builder.CreateICmpSLT(next,times),loop,done);
+        Builder.SetInsertPoint(done);
+    }
+
     struct branchBiasPass:public FunctionPass {
         static char ID;
         branchBiasPass() : FunctionPass(ID) {}
 
-        //second and right implementation approach
+        Function* DumpFunc=nullptr;
+        CallInst* DumpPrint=nullptr;       //the printOutBranchInfo call of the dump, the functions replay their branches before it
+
+        /* With -cse231-bb-edge-profile, only the edges off a spanning tree of the CFG are counted (see EdgeProfile.h). Instead
+           of printing at every return, a destructor registered in llvm.global_dtors derives the number of taken and not taken
+           branches of every function once at exit, replays them to updateBranchInfo and calls printOutBranchInfo. The code of
+           each function is added to the dump as it is instrumented, doFinalization comes after opt has written the module */
+        bool doInitialization(Module &M) override {
+            if(!EdgeProfiling)
+                return false;
+            LLVMContext &context=M.getContext();
+            DumpFunc=Function::Create(FunctionType::get(Type::getVoidTy(context),false),GlobalValue::InternalLinkage,"cse231.bb.dump",M);
+            IRBuilder<> Builder(BasicBlock::Create(context,"entry",DumpFunc));
+            FunctionCallee printInstr=M.getOrInsertFunction("printOutBranchInfo",Type::getVoidTy(context));
+            DumpPrint=Builder.CreateCall(printInstr);
+            Builder.CreateRetVoid();
+            appendToGlobalDtors(M,DumpFunc,0);
+            return true;
+        }
+
+        bool runOnEdgeProfile(Function &F){
+            EdgeProfile profile(F);
+            EdgeProfile::LinearCount taken, notTaken;     //taken and not taken conditional branches as combinations of the edge counters
+            for(BasicBlock& B: F){
+                BranchInst *BI=dyn_cast<BranchInst>(B.getTerminator());
+                if(BI!=nullptr && BI->isConditional()){
+                    EdgeProfile::addScaled(taken,profile.getEdgeCount(&B,0),1);
+                    EdgeProfile::addScaled(notTaken,profile.getEdgeCount(&B,1),1);
+                }
+            }
+            if(taken.empty() && notTaken.empty())     //no conditional branch
+                return false;
+            GlobalVariable* edgeCounters=profile.instrument("cse231.bb.edges");
+
+            //the replay loops need blocks of their own, so split the dump before the print
+            BasicBlock* cur=DumpPrint->getParent();
+            BasicBlock* rest=cur->splitBasicBlock(DumpPrint);
+            cur->getTerminator()->eraseFromParent();
+            IRBuilder<> Builder(cur);
+            Module* mod=F.getParent();
+            FunctionCallee update=mod->getOrInsertFunction("updateBranchInfo",Type::getVoidTy(mod->getContext()),Type::getInt1Ty(mod->getContext()));
+            emitCallLoop(Builder,EdgeProfile::emitCount(Builder,edgeCounters,taken),update,Builder.getInt1(1));
+            emitCallLoop(Builder,EdgeProfile::emitCount(Builder,edgeCounters,notTaken),update,Builder.getInt1(0));
+            Builder.CreateBr(rest);
+            return false;
+        }
+
         bool runOnFunction(Function &F) override {
             Module* mod=F.getParent();      //get the module that contains function F
             LLVMContext &context=mod->getContext();     //get module context (what's the difference between mod->getContext() and F.getContext())
+            if(EdgeProfiling)
+                return (F.isDeclaration() || &F==DumpFunc)?false:runOnEdgeProfile(F);
             
             for(auto B=F.begin(), BEnd=F.end();B!=BEnd;B++){
                 for(auto I=B->begin(),IEnd=B->end();I!=IEnd;I++){
@@ -1,3 +1,4 @@
+#include "EdgeProfile.h"
 #include "llvm/Pass.h"
 #include "llvm/IR/Function.h"
 #include "llvm/Support/raw_ostream.h"
@@ -5,19 +6,113 @@
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/GlobalVariable.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Transforms/Utils/ModuleUtils.h"
+#include <map>
 #include <unordered_map>
 #include <string>
 
 using namespace llvm;
 
+static cl::opt<bool> InlineCounters("cse231-cdi-inline", cl::init(false),
+    cl::desc("Count instructions with inline atomic adds and print the counts at exit instead of calling the runtime"));
+static cl::opt<bool> EdgeProfiling("cse231-cdi-edge-profile", cl::init(false),
+    cl::desc("Only count the CFG edges off a maximum spanning tree and derive the instruction counts at exit"));
+
 namespace{
     struct countInstrPass:public FunctionPass {
         static char ID;
         countInstrPass() : FunctionPass(ID) {}
 
+        GlobalVariable* Counters=nullptr;       //[OtherOpsEnd x i64] counter of each opcode, only used with -cse231-cdi-inline or -cse231-cdi-edge-profile
+        Function* DumpFunc=nullptr;
+
+
+        /* With -cse231-cdi-inline, every block adds its counts to the counter array of the module with relaxed atomic adds, so
+           threads never wait on each other or call into the runtime. A destructor registered in llvm.global_dtors prints the
+           non-zero counters once at exit, one "opcode<tab>count" line per opcode in opcode order */
+        /* With -cse231-cdi-edge-profile, counters are only put on the edges off a spanning tree of the CFG (see EdgeProfile.h), and
+           every function adds code to the start of the dump that derives its opcode counts from them. (doFinalization comes too
+           late for that, after opt has written the module) */
+        bool doInitialization(Module &M) override {
+            if(!InlineCounters && !EdgeProfiling)
+                return false;
+            LLVMContext &context=M.getContext();
+            Type* Int64Ty=Type::getInt64Ty(context);
+            Type* Int8PtrTy=Type::getInt8PtrTy(context);
+            unsigned numOpcodes=Instruction::OtherOpsEnd;   //opcodes are numbered from 1, slot 0 stays zero
+
+            ArrayType* CountTy=ArrayType::get(Int64Ty,numOpcodes);
+            Counters=new GlobalVariable(M,CountTy,false,GlobalValue::InternalLinkage,ConstantAggregateZero::get(CountTy),"cse231.cdi.counts");
+
+            DumpFunc=Function::Create(FunctionType::get(Type::getVoidTy(context),false),GlobalValue::InternalLinkage,"cse231.cdi.dump",M);
+            BasicBlock* entry=BasicBlock::Create(context,"entry",DumpFunc);
+            BasicBlock* loop=BasicBlock::Create(context,"loop",DumpFunc);
+            BasicBlock* print=BasicBlock::Create(context,"print",DumpFunc);
+            BasicBlock* latch=BasicBlock::Create(context,"latch",DumpFunc);
+            BasicBlock* exit=BasicBlock::Create(context,"exit",DumpFunc);
+            IRBuilder<> Builder(entry);
+
+            //opcode names are only known at compile time, so the dump looks them up in a table indexed by opcode
+            std::vector<Constant*> names;
+            names.push_back(ConstantPointerNull::get(cast<PointerType>(Int8PtrTy)));
+            for(unsigned opcode=1;opcode<numOpcodes;opcode++)
+                names.push_back(Builder.CreateGlobalStringPtr(Instruction::getOpcodeName(opcode)));
+            ArrayType* NameTy=ArrayType::get(Int8PtrTy,numOpcodes);
+            GlobalVariable* NameTable=new GlobalVariable(M,NameTy,true,GlobalValue::PrivateLinkage,ConstantArray::get(NameTy,names),"cse231.cdi.names");
+            Constant* format=Builder.CreateGlobalStringPtr("%s\t%lu\n");
+            FunctionCallee dprintf=M.getOrInsertFunction("dprintf",FunctionType::get(Type::getInt32Ty(context),{Type::getInt32Ty(context),Int8PtrTy},true));
+            Builder.CreateBr(loop);
+
+            Builder.SetInsertPoint(loop);
+            PHINode* opcode=Builder.CreatePHI(Int64Ty,2);
+            opcode->addIncoming(Builder.getInt64(1),entry);
+            Value* count=Builder.CreateLoad(Int64Ty,Builder.CreateInBoundsGEP(CountTy,Counters,{Builder.getInt64(0),opcode}));
+            Builder.CreateCondBr(Builder.CreateICmpNE(count,Builder.getInt64(0)),print,latch);
+
+            Builder.SetInsertPoint(print);
+            Value* name=Builder.CreateLoad(Int8PtrTy,Builder.CreateInBoundsGEP(NameTy,NameTable,{Builder.getInt64(0),opcode}));
+            Builder.CreateCall(dprintf,{Builder.getInt32(2),format,name,count});     //straight to stderr, like the runtime
+            Builder.CreateBr(latch);
+
+            Builder.SetInsertPoint(latch);
+            Value* next=Builder.CreateAdd(opcode,Builder.getInt64(1));
+            opcode->addIncoming(next,latch);
+            Builder.CreateCondBr(Builder.CreateICmpEQ(next,Builder.getInt64(numOpcodes)),exit,loop);
+
+            Builder.SetInsertPoint(exit);
+            Builder.CreateRetVoid();
+
+            appendToGlobalDtors(M,DumpFunc,0);
+            return true;
+        }
+
         bool runOnFunction(Function &F) override {
             Module* mod=F.getParent();      //get the module that contains function F
             LLVMContext &context=mod->getContext();     //get module context (what's the difference between mod->getContext() and F.getContext())
+            if(&F==DumpFunc)
+                return false;
+
+            if(EdgeProfiling && !F.isDeclaration()){
+                EdgeProfile profile(F);
+                std::map<unsigned, EdgeProfile::LinearCount> opcodeCounts;      //executions of each opcode as a combination of the edge counters
+                for(BasicBlock& B: F){
+                    EdgeProfile::LinearCount blockCount=profile.getBlockCount(&B);
+                    for(Instruction& I: B)
+                        EdgeProfile::addScaled(opcodeCounts[I.getOpcode()],blockCount,1);
+                }
+                GlobalVariable* edgeCounters=profile.instrument("cse231.cdi.edges");     //changes the CFG, so it comes after the counts are read
+
+                IRBuilder<> Builder(DumpFunc->getEntryBlock().getTerminator());
+                for(auto& pair: opcodeCounts){
+                    if(pair.second.empty())
+                        continue;
+                    Value* slot=Builder.CreateConstInBoundsGEP2_32(Counters->getValueType(),Counters,0,pair.first);
+                    Value* count=EdgeProfile::emitCount(Builder,edgeCounters,pair.second);
+                    Builder.CreateStore(Builder.CreateAdd(Builder.CreateLoad(Builder.getInt64Ty(),slot),count),slot);
+                }
+                return false;
+            }
             
             for(auto B=F.begin(), BEnd=F.end();B!=BEnd;B++){
                 std::unordered_map<int,int> dic;
@@ -31,15 +126,24 @@ namespace{
                         dic[I->getOpcode()]+=1;
                     }
                 }
-                for(auto pair:dic){
-                    keys.push_back(pair.first);
-                    values.push_back(pair.second);
-                }
                 
                 /* the place to insert function call is important, can't use Builder(&*B) since this will insert some codes even after the block that contains Return, which will cause unterminated function */
                 Instruction &lastI=B->back();
                 IRBuilder<> Builder(&lastI);   //thus we should insert the function call before the last instruction in this block, thus Return will happen normally
 
+                if(InlineCounters){
+                    for(auto pair:dic){
+                        Value* slot=Builder.CreateConstInBoundsGEP2_32(Counters->getValueType(),Counters,0,pair.first);
+                        Builder.CreateAtomicRMW(AtomicRMWInst::Add,slot,Builder.getInt64(pair.second),MaybeAlign(8),AtomicOrdering::Monotonic);
+                    }
+                    continue;
+                }
+
+                for(auto pair:dic){
+                    keys.push_back(pair.first);
+                    values.push_back(pair.second);
+                }
+
                 ConstantInt *Length = Builder.getInt16(dic.size());     //first param
 
                 ArrayType* ArrayTy = ArrayType::get(IntegerType::get(F.getContext(), 32), dic.size());   //define the array type, is F.getContext() the same with F.getParent()->getContext() here?
@@ -61,7 +165,9 @@ namespace{
                 Builder.CreateCall(countInstrInBlock,argRef);       //insert the function
             }
 
-            /* insert the print function before the last instruction */
+            /* insert the print function before the last instruction, the inline counters are printed at exit instead */
+            if(InlineCounters)
+                return false;
             BasicBlock &lastB=F.back();
             Instruction &lastI=lastB.back();
             IRBuilder<> Builder(&lastI);        
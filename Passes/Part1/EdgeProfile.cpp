@@ -0,0 +1,223 @@
+//===- EdgeProfile.cpp - Spanning tree edge counters ----------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "EdgeProfile.h"
+#include "llvm/Analysis/CFG.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include <algorithm>
+#include <numeric>
+
+using namespace llvm;
+
+// Edges of the tree need no counter, so the weight of an edge estimates how
+// often it runs: 16 times more per loop level.
+static uint64_t loopDepthWeight(unsigned depth) {
+  return uint64_t(1) << (4 * std::min(depth, 14u));
+}
+
+EdgeProfile::EdgeProfile(Function &F) : F(F) {
+  for (BasicBlock &B : F) {
+    BlockIds[&B] = Blocks.size();
+    Blocks.push_back(&B);
+  }
+  ExitNode = Blocks.size();
+  Incident.resize(Blocks.size() + 1);
+
+  DominatorTree DT(F);
+  LoopInfo LI(DT);
+  // EXIT->entry can't be counted, it has to be on the tree
+  addEdge(ExitNode, 0, 0, UINT64_MAX);
+  for (BasicBlock *B : Blocks) {
+    Instruction *TI = B->getTerminator();
+    unsigned depth = LI.getLoopDepth(B);
+    if (TI->getNumSuccessors() == 0) {
+      addEdge(BlockIds[B], ExitNode, 0, loopDepthWeight(depth) << 1);
+      continue;
+    }
+    for (unsigned i = 0, e = TI->getNumSuccessors(); i != e; ++i) {
+      BasicBlock *succ = TI->getSuccessor(i);
+      uint64_t weight = loopDepthWeight(std::min(depth, LI.getLoopDepth(succ))) << 1;
+      // Among edges of the same depth, prefer keeping the critical ones on the
+      // tree, as their counter would need a block of its own. Those that
+      // can't be split at all should never be chords.
+      if (isCriticalEdge(TI, i)) {
+        if (isa<IndirectBrInst>(TI) || succ->isEHPad())
+          weight = UINT64_MAX - 1;
+        else
+          weight |= 1;
+      }
+      SuccEdges[std::make_pair(B, i)] = Edges.size();
+      addEdge(BlockIds[B], BlockIds[succ], i, weight);
+    }
+  }
+
+  buildSpanningTree();
+  solveTreeEdges();
+}
+
+void EdgeProfile::addEdge(unsigned src, unsigned dst, unsigned succNum, uint64_t weight) {
+  Incident[src].push_back(Edges.size());
+  if (dst != src)
+    Incident[dst].push_back(Edges.size());
+  Edges.push_back(ProfEdge{src, dst, succNum, weight, -1});
+}
+
+// Kruskal's algorithm, heaviest edges first
+void EdgeProfile::buildSpanningTree() {
+  std::vector<unsigned> order(Edges.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [this](unsigned a, unsigned b) {
+    return Edges[a].Weight > Edges[b].Weight;
+  });
+
+  std::vector<unsigned> leader(Incident.size());
+  std::iota(leader.begin(), leader.end(), 0);
+  auto find = [&leader](unsigned node) {
+    while (leader[node] != node)
+      node = leader[node] = leader[leader[node]];
+    return node;
+  };
+  for (unsigned id : order) {
+    unsigned src = find(Edges[id].Src), dst = find(Edges[id].Dst);
+    if (src != dst)
+      leader[src] = dst;
+    else
+      Edges[id].Counter = NumCounters++;
+  }
+}
+
+// Peel the leaves of the tree: the only unknown edge of a leaf is the
+// difference between the known flow into and out of it.
+void EdgeProfile::solveTreeEdges() {
+  Counts.assign(Edges.size(), LinearCount());
+  std::vector<unsigned> unknown(Incident.size(), 0);
+  for (unsigned id = 0; id < Edges.size(); ++id) {
+    const ProfEdge &edge = Edges[id];
+    if (edge.Counter >= 0) {
+      Counts[id].push_back(std::make_pair((unsigned)edge.Counter, (int64_t)1));
+    } else {
+      ++unknown[edge.Src];
+      ++unknown[edge.Dst];
+    }
+  }
+
+  std::vector<bool> solved(Edges.size());
+  for (unsigned id = 0; id < Edges.size(); ++id)
+    solved[id] = Edges[id].Counter >= 0;
+  std::vector<unsigned> leaves;
+  for (unsigned node = 0; node < Incident.size(); ++node)
+    if (unknown[node] == 1)
+      leaves.push_back(node);
+
+  while (!leaves.empty()) {
+    unsigned node = leaves.back();
+    leaves.pop_back();
+    if (unknown[node] != 1)
+      continue;
+    unsigned treeEdge = 0;
+    LinearCount inMinusOut;
+    for (unsigned id : Incident[node]) {
+      if (!solved[id]) {
+        treeEdge = id;
+        continue;
+      }
+      const ProfEdge &edge = Edges[id];
+      if (edge.Src == edge.Dst)
+        continue;
+      addScaled(inMinusOut, Counts[id], edge.Dst == node ? 1 : -1);
+    }
+    const ProfEdge &edge = Edges[treeEdge];
+    addScaled(Counts[treeEdge], inMinusOut, edge.Dst == node ? -1 : 1);
+    solved[treeEdge] = true;
+    --unknown[edge.Src];
+    --unknown[edge.Dst];
+    unsigned other = edge.Src == node ? edge.Dst : edge.Src;
+    if (unknown[other] == 1)
+      leaves.push_back(other);
+  }
+}
+
+EdgeProfile::LinearCount EdgeProfile::getBlockCount(BasicBlock *B) const {
+  LinearCount count;
+  unsigned node = BlockIds.lookup(B);
+  for (unsigned id : Incident[node])
+    if (Edges[id].Src == node)
+      addScaled(count, Counts[id], 1);
+  return count;
+}
+
+void EdgeProfile::addScaled(LinearCount &dst, const LinearCount &src, int64_t k) {
+  LinearCount sum;
+  auto d = dst.begin();
+  auto s = src.begin();
+  while (d != dst.end() || s != src.end()) {
+    if (s == src.end() || (d != dst.end() && d->first < s->first)) {
+      sum.push_back(*d++);
+    } else if (d == dst.end() || s->first < d->first) {
+      sum.push_back(std::make_pair(s->first, k * s->second));
+      ++s;
+    } else {
+      int64_t coeff = d->second + k * s->second;
+      if (coeff != 0)
+        sum.push_back(std::make_pair(d->first, coeff));
+      ++d;
+      ++s;
+    }
+  }
+  dst = std::move(sum);
+}
+
+GlobalVariable *EdgeProfile::instrument(const Twine &name) {
+  if (NumCounters == 0)
+    return nullptr;
+  Module *M = F.getParent();
+  ArrayType *CounterTy = ArrayType::get(Type::getInt64Ty(M->getContext()), NumCounters);
+  GlobalVariable *counters = new GlobalVariable(*M, CounterTy, false, GlobalValue::InternalLinkage, ConstantAggregateZero::get(CounterTy), name);
+
+  for (const ProfEdge &edge : Edges) {
+    if (edge.Counter < 0)
+      continue;
+    BasicBlock *src = Blocks[edge.Src];
+    Instruction *TI = src->getTerminator();
+    Instruction *insertPt;
+    if (edge.Dst == ExitNode || TI->getNumSuccessors() == 1) {
+      insertPt = TI;
+    } else {
+      BasicBlock *dst = TI->getSuccessor(edge.SuccNum);
+      if (dst->hasNPredecessors(1)) {
+        insertPt = &*dst->getFirstInsertionPt();
+      } else if (BasicBlock *split = SplitCriticalEdge(TI, edge.SuccNum)) {
+        insertPt = split->getTerminator();
+      } else {
+        // Only unsplittable edges the tree could not take end here, they
+        // are counted with the other predecessors of dst
+        insertPt = &*dst->getFirstInsertionPt();
+      }
+    }
+    IRBuilder<> Builder(insertPt);
+    Value *slot = Builder.CreateConstInBoundsGEP2_32(CounterTy, counters, 0, edge.Counter);
+    Builder.CreateAtomicRMW(AtomicRMWInst::Add, slot, Builder.getInt64(1), MaybeAlign(8), AtomicOrdering::Monotonic);
+  }
+  return counters;
+}
+
+Value *EdgeProfile::emitCount(IRBuilder<> &Builder, GlobalVariable *counters, const LinearCount &count) {
+  Value *sum = Builder.getInt64(0);
+  for (auto &term : count) {
+    Value *slot = Builder.CreateConstInBoundsGEP2_32(counters->getValueType(), counters, 0, term.first);
+    Value *value = Builder.CreateLoad(Builder.getInt64Ty(), slot);
+    if (term.second != 1)
+      value = Builder.CreateMul(value, Builder.getInt64(term.second));
+    sum = Builder.CreateAdd(sum, value);
+  }
+  return sum;
+}
@@ -0,0 +1,110 @@
+//===- EdgeProfile.h - Spanning tree edge counters -----------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file provides the optimal counter placement shared by the profiling
+// passes of CSE 231 part 1.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_231EDGEPROFILE_H
+#define LLVM_TRANSFORMS_231EDGEPROFILE_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/IRBuilder.h"
+#include <utility>
+#include <vector>
+
+namespace llvm {
+
+/*
+ * Knuth's optimal counter placement for the CFG of a function.
+ * The blocks and a virtual EXIT node form a graph with an edge for every
+ * successor of a terminator, an edge from every block without successors to
+ * EXIT, and an edge from EXIT to the entry that closes the flow. A maximum
+ * spanning tree is built with edges weighted by loop depth, so the hot edges
+ * stay on the tree, and only the remaining edges (the chords) get a counter.
+ * By flow conservation the count of every edge is a linear combination of
+ * the chord counters, which is worked out at compile time and evaluated when
+ * the counts are dumped.
+ * A function left by exit() or longjmp breaks the conservation, so its counts
+ * are only approximate.
+ */
+class EdgeProfile {
+  public:
+    /*
+     * Sum of coeff * counter[id] as (id, coeff) pairs sorted by id.
+     */
+    typedef SmallVector<std::pair<unsigned, int64_t>, 4> LinearCount;
+
+    explicit EdgeProfile(Function &F);
+    EdgeProfile(const EdgeProfile &) = delete;
+    EdgeProfile &operator=(const EdgeProfile &) = delete;
+
+    unsigned getNumCounters() const { return NumCounters; }
+
+    /*
+     * Times the edge from src to its successor number succNum is taken.
+     */
+    const LinearCount &getEdgeCount(BasicBlock *src, unsigned succNum) const {
+      return Counts[SuccEdges.lookup(std::make_pair(src, succNum))];
+    }
+
+    /*
+     * Times the block is executed, the sum of its outgoing edges.
+     */
+    LinearCount getBlockCount(BasicBlock *B) const;
+
+    /*
+     * dst += k * src.
+     */
+    static void addScaled(LinearCount &dst, const LinearCount &src, int64_t k);
+
+    /*
+     * Create the counter array of the function and increment it with relaxed
+     * atomic adds on the chords, splitting critical edges where needed. The
+     * counts must be read before, as it changes the CFG. Returns nullptr if
+     * the function needs no counter.
+     */
+    GlobalVariable *instrument(const Twine &name);
+
+    /*
+     * Emit the evaluation of count at the insertion point of Builder.
+     */
+    static Value *emitCount(IRBuilder<> &Builder, GlobalVariable *counters, const LinearCount &count);
+
+  private:
+    struct ProfEdge {
+      unsigned Src, Dst;      // node ids, blocks in layout order then EXIT
+      unsigned SuccNum;
+      uint64_t Weight;
+      int Counter;            // -1 for the edges of the tree
+    };
+
+    void addEdge(unsigned src, unsigned dst, unsigned succNum, uint64_t weight);
+    void buildSpanningTree();
+    void solveTreeEdges();
+
+    Function &F;
+    std::vector<BasicBlock *> Blocks;
+    DenseMap<BasicBlock *, unsigned> BlockIds;
+    unsigned ExitNode;
+    std::vector<ProfEdge> Edges;
+    std::vector<SmallVector<unsigned, 4>> Incident;    // edge ids of each node
+    DenseMap<std::pair<BasicBlock *, unsigned>, unsigned> SuccEdges;
+    std::vector<LinearCount> Counts;
+    unsigned NumCounters = 0;
+};
+
+} // namespace llvm
+
+#endif
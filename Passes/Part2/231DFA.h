@@ -0,0 +1,1229 @@
+//===- CSE231.h - Header for CSE 231 projects ----------------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file provides the interface for the passes of CSE 231 projects
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_231DFA_H
+#define LLVM_TRANSFORMS_231DFA_H
+
+#include "231ResultFormat.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/STLFunctionalExtras.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <queue>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Solver statistics are compiled in only with -DCSE231_DFA_STATS=1 (cmake -DCSE231_DFA_STATS=ON)
+#ifndef CSE231_DFA_STATS
+#define CSE231_DFA_STATS 0
+#endif
+
+namespace llvm {
+
+class CallGraph;
+class CallGraphNode;
+
+// Command line options shared by the passes, defined in 231DFA.cpp. Every
+// part's library links that file, so the library loaded first registers them
+// and the others refer to its options.
+extern cl::opt<bool> &DFABlockGranularity;
+extern cl::opt<unsigned> &DFAThreads;
+extern cl::opt<std::string> &DFACacheDir;
+
+enum DFAOutputFormatKind { DFATextOutput, DFABinaryOutput };
+extern cl::opt<DFAOutputFormatKind> &DFAOutputFormat;
+extern cl::opt<std::string> &DFAOutputFile;
+extern cl::opt<std::string> &DFAStatsDir;
+
+/*
+ * Module level driver of the per-function analyses.
+ * Runs Body on every function with a body of M, on up to DFAThreads threads
+ * (0 means one per hardware thread). Idle threads take the next unprocessed
+ * function, and the text each call writes to its stream is buffered and
+ * written to OS in module order, so the output does not depend on scheduling.
+ * Body must only read shared state, or guard it.
+ * The output goes to -cse231-output instead of OS when it is given, and in
+ * the binary format it starts with the file header of 231ResultFormat.h.
+ *
+ * With -cse231-cache-dir and a non-empty CacheTag, the text of each function
+ * is also kept on disk, and Body is skipped for the functions found there.
+ * The key hashes CacheTag, the printed IR of the function and whatever
+ * CacheKey adds, which must cover everything else the output depends on.
+ * CacheKey is called on the thread of the function, just before Body.
+ *
+ * With -time-trace, each function is a CSE231Function event, on the thread
+ * that analyzed it.
+ */
+void runOnFunctionsInParallel(Module &M, function_ref<void(Function &, raw_ostream &)> Body, raw_ostream &OS,
+                              StringRef CacheTag = "", function_ref<void(Function &, MD5 &)> CacheKey = nullptr);
+
+/*
+ * runOnFunctionsInParallel for the analyses that first summarize the
+ * functions bottom-up over the call graph CG of M: SCCBody runs on every SCC
+ * CallGraphSCCPass would visit, once it ran on all the SCCs they call, and
+ * Body runs on a function once SCCBody ran on all the SCCs it calls. The
+ * nodes of no function stand for the same code outside the module, so a
+ * function calling through the calls-external node also waits for the SCC of
+ * the external calling node. The threads pick the ready SCCs before the ready
+ * functions, so the summaries and the solves of the functions already
+ * summarized overlap. SCCBody may write what its SCC owns and read what the
+ * SCCs it calls own; CacheKey runs just before Body, with the same guarantee.
+ */
+void runOnCallGraphInParallel(Module &M, CallGraph &CG, function_ref<void(ArrayRef<CallGraphNode *>)> SCCBody,
+                              function_ref<void(Function &, raw_ostream &)> Body, raw_ostream &OS,
+                              StringRef CacheTag = "", function_ref<void(Function &, MD5 &)> CacheKey = nullptr);
+
+/*
+ * What the worklist algorithm did on one function. Only collected when
+ * CSE231_DFA_STATS is set; otherwise Enabled is false, the counting code is
+ * dead and everything but the first two counters stays zero.
+ * Nodes are blocks in block granularity mode.
+ */
+struct DFASolverStats {
+	static constexpr bool Enabled = CSE231_DFA_STATS;
+
+	uint64_t NodeVisits = 0;          // items popped from the worklist
+	uint64_t FlowFunctionCalls = 0;
+	uint64_t Joins = 0;               // joins of the solver, not those inside flow functions
+	uint64_t EqualityChecks = 0;
+	uint64_t Requeues = 0;            // items queued again after the initial fill
+	uint64_t FactUpdates = 0;         // edges that changed, the facts below are sampled there
+	uint64_t FactSizeSum = 0;
+	unsigned MaxFactSize = 0;
+	uint64_t InfoBytes = 0;           // Info objects allocated, not counting what they own
+	std::vector<unsigned> VisitsPerNode;
+
+	void recordFact(unsigned size) {
+		FactUpdates++;
+		FactSizeSum += size;
+		MaxFactSize = std::max(MaxFactSize, size);
+	}
+
+	double getMeanFactSize() const {
+		return FactUpdates ? double(FactSizeSum) / FactUpdates : 0;
+	}
+};
+
+/*
+ * Add the statistics of the solve of F by the analysis to the -stats counters
+ * of the framework, and write them to <-cse231-stats-dir>/<Analysis>.<function>.json
+ * when that option is given. Does nothing in builds without CSE231_DFA_STATS.
+ * Safe to call from the threads of runOnFunctionsInParallel.
+ */
+void reportSolverStats(StringRef Analysis, const Function &F, const DFASolverStats &Stats);
+
+/*
+ * How the flow functions treat an instruction:
+ *   DefInstr:    defines a variable (arithmetic, comparisons, select, alloca, load, getelementptr)
+ *   NonDefInstr: defines none (br, store, and every other instruction)
+ *   PhiInstr:    a phi; the phis at the top of a block are one node
+ * The switch compiles to a table lookup on the opcode.
+ */
+enum InstrKind { DefInstr, NonDefInstr, PhiInstr };
+
+inline InstrKind classifyInstr(const Instruction * I) {
+	switch (I->getOpcode()) {
+	case Instruction::Add: case Instruction::FAdd:
+	case Instruction::Sub: case Instruction::FSub:
+	case Instruction::Mul: case Instruction::FMul:
+	case Instruction::UDiv: case Instruction::SDiv: case Instruction::FDiv:
+	case Instruction::URem: case Instruction::SRem: case Instruction::FRem:
+	case Instruction::Shl: case Instruction::LShr: case Instruction::AShr:
+	case Instruction::And: case Instruction::Or: case Instruction::Xor:
+	case Instruction::ICmp: case Instruction::FCmp:
+	case Instruction::Select:
+	case Instruction::Alloca:
+	case Instruction::Load:
+	case Instruction::GetElementPtr:
+		return DefInstr;
+	case Instruction::PHI:
+		return PhiInstr;
+	default:
+		return NonDefInstr;
+	}
+}
+
+/*
+ * This is the base class to represent information in a dataflow analysis.
+ * For a specific analysis, you need to create a sublcass of it.
+ */
+class Info {
+  public:
+    Info() {}
+    Info(const Info& other) {}
+    virtual ~Info() {};
+
+    /*
+     * Print out the information to OS
+     *
+     * Direction:
+     *   In your subclass you should implement this function according to the project specifications.
+     */
+    virtual void print(raw_ostream &OS) = 0;
+
+    /*
+     * Write the information to the binary output (-cse231-output-format=binary).
+     * By default it is kept as the text print writes it; subclasses may use a
+     * more compact fact kind of 231ResultFormat.h.
+     */
+    virtual void write(cse231result::FunctionWriter &W) {
+    	std::string text;
+    	raw_string_ostream OS(text);
+    	print(OS);
+    	W.writeText(OS.str());
+    }
+
+    /*
+     * Number of elements of the information, sampled by the solver statistics.
+     */
+    virtual unsigned size() { return 0; }
+
+    /*
+     * Compare two pieces of information
+     *
+     * Direction:
+     *   In your subclass you need to implement this function.
+     */
+    static bool equals(Info * info1, Info * info2);
+    /*
+     * Join two pieces of information.
+     * The third parameter points to the result.
+     *
+     * Direction:
+     *   In your subclass you need to implement this function.
+     */
+    static Info* join(Info * info1, Info * info2, Info * result);
+    /*
+     * Join src into dst, as join(src, dst, dst) would. Returns true if dst changed.
+     * The solver merges the output of a flow function into the information of an
+     * edge with it, instead of a join into a new object and a comparison.
+     *
+     * Direction:
+     *   In your subclass you need to implement this function.
+     */
+    static bool joinInto(Info * src, Info * dst);
+};
+
+/*
+ * Dense bit vector used as the fact of set-based analyses whose elements are
+ * instruction indices (as assigned by assignIndiceToInstrs).
+ * It grows on demand; missing words are zero. Union and comparison work one
+ * machine word at a time, four at a time with AVX2.
+ */
+class FactBitVector {
+  private:
+		typedef uint64_t Word;
+		static const unsigned WordBits = 64;
+		std::vector<Word> Words;
+
+		void grow(unsigned numWords) {
+			if (Words.size() < numWords)
+				Words.resize(numWords, 0);
+		}
+
+  public:
+		void set(unsigned i) {
+			grow(i / WordBits + 1);
+			Words[i / WordBits] |= Word(1) << (i % WordBits);
+		}
+
+		void reset(unsigned i) {
+			if (i / WordBits < Words.size())
+				Words[i / WordBits] &= ~(Word(1) << (i % WordBits));
+		}
+
+		bool test(unsigned i) const {
+			return i / WordBits < Words.size() && (Words[i / WordBits] >> (i % WordBits)) & 1;
+		}
+
+		/*
+		 * Union other into this vector. Returns true if this vector changed.
+		 */
+		bool unionWith(const FactBitVector &other) {
+			unsigned n = other.Words.size();
+			grow(n);
+			Word * dst = Words.data();
+			const Word * src = other.Words.data();
+			unsigned i = 0;
+			Word changed = 0;
+#if defined(__AVX2__)
+			__m256i diff = _mm256_setzero_si256();
+			for (; i + 4 <= n; i += 4) {
+				__m256i a = _mm256_loadu_si256((const __m256i *)(dst + i));
+				__m256i b = _mm256_loadu_si256((const __m256i *)(src + i));
+				__m256i r = _mm256_or_si256(a, b);
+				diff = _mm256_or_si256(diff, _mm256_xor_si256(a, r));
+				_mm256_storeu_si256((__m256i *)(dst + i), r);
+			}
+			changed = !_mm256_testz_si256(diff, diff);
+#endif
+			for (; i < n; ++i) {
+				Word r = dst[i] | src[i];
+				changed |= r ^ dst[i];
+				dst[i] = r;
+			}
+			return changed != 0;
+		}
+
+		FactBitVector &operator|=(const FactBitVector &other) {
+			unionWith(other);
+			return *this;
+		}
+
+		bool operator==(const FactBitVector &other) const {
+			const std::vector<Word> &shorter = Words.size() < other.Words.size() ? Words : other.Words;
+			const std::vector<Word> &longer = Words.size() < other.Words.size() ? other.Words : Words;
+			unsigned n = shorter.size();
+			unsigned i = 0;
+#if defined(__AVX2__)
+			for (; i + 4 <= n; i += 4) {
+				__m256i a = _mm256_loadu_si256((const __m256i *)(shorter.data() + i));
+				__m256i b = _mm256_loadu_si256((const __m256i *)(longer.data() + i));
+				__m256i d = _mm256_xor_si256(a, b);
+				if (!_mm256_testz_si256(d, d))
+					return false;
+			}
+#endif
+			for (; i < n; ++i) {
+				if (shorter[i] != longer[i])
+					return false;
+			}
+			for (; i < longer.size(); ++i) {
+				if (longer[i] != 0)
+					return false;
+			}
+			return true;
+		}
+
+		bool operator!=(const FactBitVector &other) const { return !(*this == other); }
+
+		unsigned count() const {
+			unsigned n = 0;
+			for (Word w : Words)
+				n += countPopulation(w);
+			return n;
+		}
+
+		/*
+		 * Call f on every set bit, in increasing order.
+		 */
+		template <typename Fn>
+		void forEach(Fn f) const {
+			for (unsigned i = 0; i < Words.size(); ++i) {
+				Word w = Words[i];
+				while (w) {
+					f(i * WordBits + countTrailingZeros(w));
+					w &= w - 1;
+				}
+			}
+		}
+};
+
+/*
+ * Worklist of small integer items that always pops the queued item with the
+ * smallest priority. The priority of an item is its position in the order
+ * given to init(). An item is queued at most once at a time.
+ */
+class OrderedWorklist {
+  private:
+		std::priority_queue<unsigned, std::vector<unsigned>, std::greater<unsigned>> Heap;
+		std::vector<unsigned> ItemOfPriority;
+		std::vector<unsigned> PriorityOfItem;
+		BitVector Queued;
+
+  public:
+		/*
+		 * Set the item order. numItems bounds the item values; items missing
+		 * from order are never queued.
+		 */
+		void init(const std::vector<unsigned> &order, unsigned numItems) {
+			ItemOfPriority = order;
+			PriorityOfItem.assign(numItems, ~0u);
+			for (unsigned i = 0; i < order.size(); ++i)
+				PriorityOfItem[order[i]] = i;
+			Queued.clear();
+			Queued.resize(numItems);
+			Heap = decltype(Heap)();
+		}
+
+		/*
+		 * Queue an item. Returns false if it was already queued.
+		 */
+		bool push(unsigned item) {
+			assert(PriorityOfItem[item] != ~0u && "Item has no priority.");
+			if (Queued.test(item))
+				return false;
+			Queued.set(item);
+			Heap.push(PriorityOfItem[item]);
+			return true;
+		}
+
+		unsigned pop() {
+			unsigned item = ItemOfPriority[Heap.top()];
+			Heap.pop();
+			Queued.reset(item);
+			return item;
+		}
+
+		bool empty() const { return Heap.empty(); }
+		unsigned size() const { return Heap.size(); }
+};
+
+/*
+ * Pool of Info objects owned by a dataflow analysis.
+ * Objects come from a bump allocator and are destroyed together by reset()
+ * or by the destructor of the pool. Superseded objects are handed back with
+ * recycle() and reused by later create() calls, so the number of objects stays
+ * proportional to the number of live facts instead of the number of iterations.
+ */
+template <class Info>
+class InfoPool {
+  private:
+		SpecificBumpPtrAllocator<Info> Allocator;
+		std::vector<Info *> FreeList;
+		unsigned NumAllocated;
+
+  public:
+		InfoPool() : NumAllocated(0) {}
+		InfoPool(const InfoPool &) = delete;
+		InfoPool &operator=(const InfoPool &) = delete;
+
+		/*
+		 * Get an object equal to a default constructed Info.
+		 */
+		Info * create() {
+			if (FreeList.empty()) {
+				NumAllocated++;
+				return new (Allocator.Allocate()) Info();
+			}
+			Info * info = FreeList.back();
+			FreeList.pop_back();
+			*info = Info();
+			return info;
+		}
+
+		void recycle(Info * info) {
+			FreeList.push_back(info);
+		}
+
+		/*
+		 * Destroy all objects.
+		 */
+		void reset() {
+			Allocator.DestroyAll();
+			FreeList.clear();
+			NumAllocated = 0;
+		}
+
+		unsigned getNumAllocated() const { return NumAllocated; }
+		unsigned getNumLive() const { return NumAllocated - FreeList.size(); }
+};
+
+/*
+ * This is the base template class to represent the generic dataflow analysis framework
+ * For a specific analysis, you need to create a sublcass of it.
+ *
+ * A subclass may pass itself as Derived (CRTP): the solver then calls its flow
+ * function statically, so that it can be inlined into the worklist loop. The
+ * subclass must be final and befriend its base. The lattice operations are always
+ * resolved statically on Info (Info::join, Info::joinInto, Info::equals); declare
+ * Info final to devirtualize print(), write() and size() as well.
+ */
+template <class Info, bool Direction, class Derived = void>
+class DataFlowAnalysis {
+
+  protected:
+		typedef std::pair<unsigned, unsigned> Edge;
+		// (neighbor node index, edge id) pairs of one node
+		typedef SmallVector<std::pair<unsigned, unsigned>, 2> AdjacencyList;
+		// Index to instruction map
+		std::vector<Instruction *> IndexToInstr;
+		// Instruction to index map
+		DenseMap<Instruction *, unsigned> InstrToIndex;
+		// Edge id to (source, destination) map
+		std::vector<Edge> Edges;
+		// Edge id to information map
+		std::vector<Info *> EdgeInfos;
+		// Per-node incoming and outgoing edges, sorted by the neighbor index
+		std::vector<AdjacencyList> Preds;
+		std::vector<AdjacencyList> Succs;
+		// The bottom of the lattice
+		Info Bottom;
+		// The initial state of the analysis
+		Info InitialState;
+		// EntryInstr points to the first instruction to be processed in the analysis
+		Instruction * EntryInstr;
+		// Solve at basic block granularity (see setBlockGranularity)
+		bool BlockGranularity;
+		// Whether the edges inside basic blocks hold their final information
+		bool Materialized;
+		// Node index to basic block id map
+		std::vector<unsigned> NodeToBlock;
+		// Nodes of each basic block, in the order the analysis visits them
+		std::vector<std::vector<unsigned>> BlockNodes;
+		// Basic block to block id map
+		DenseMap<BasicBlock *, unsigned> BlockToIndex;
+		// Number of items popped from the worklist (nodes, or blocks in block granularity mode)
+		unsigned NumWorklistIterations;
+		// Number of flow function calls
+		unsigned NumFlowFunctionCalls;
+		// Statistics of the last run, see DFASolverStats
+		DFASolverStats Stats;
+		// Owner of every Info object created by the worklist algorithm, until the analysis is destroyed
+		InfoPool<Info> Pool;
+
+		/*
+		 * Utility function:
+		 *   Replace the information of an edge, recycling the superseded object.
+		 *   Bottom and InitialState are not owned by the pool.
+		 */
+		void setEdgeInfo(unsigned id, Info * info) {
+			Info * old = EdgeInfos[id];
+			if (old != &Bottom && old != &InitialState)
+				Pool.recycle(old);
+			EdgeInfos[id] = info;
+			if (DFASolverStats::Enabled)
+				Stats.recordFact(info->size());
+		}
+
+		/*
+		 * Utility function:
+		 *   Join and compare through these in the solver, they keep the statistics.
+		 */
+		bool joinInfoInto(Info * src, Info * dst) {
+			if (DFASolverStats::Enabled)
+				Stats.Joins++;
+			return Info::joinInto(src, dst);
+		}
+
+		bool equalInfos(Info * info1, Info * info2) {
+			if (DFASolverStats::Enabled)
+				Stats.EqualityChecks++;
+			return Info::equals(info1, info2);
+		}
+
+		/*
+		 * Utility function:
+		 *   Join info, an output of the flow function, into the information of an edge.
+		 *   Returns true if the information of the edge changed.
+		 *   info is consumed: it becomes the information of the edge or goes back to the pool.
+		 */
+		bool joinIntoEdge(unsigned id, Info * info) {
+			Info * edgeInfo = EdgeInfos[id];
+			if (edgeInfo == &Bottom) {
+				// Joining with bottom gives info itself, move it into the edge
+				if (equalInfos(info, &Bottom)) {
+					Pool.recycle(info);
+					return false;
+				}
+				setEdgeInfo(id, info);
+				return true;
+			}
+			if (edgeInfo == &InitialState) {
+				// Not owned by the pool, join into a copy
+				edgeInfo = Pool.create();
+				*edgeInfo = InitialState;
+				EdgeInfos[id] = edgeInfo;
+			}
+			bool changed = joinInfoInto(info, edgeInfo);
+			Pool.recycle(info);
+			if (changed && DFASolverStats::Enabled)
+				Stats.recordFact(edgeInfo->size());
+			return changed;
+		}
+
+		/*
+		 * Utility function:
+		 *   Count a visit of a worklist item.
+		 */
+		void countVisit(unsigned item) {
+			NumWorklistIterations++;
+			if (DFASolverStats::Enabled)
+				Stats.VisitsPerNode[item]++;
+		}
+
+		/*
+		 * Utility function:
+		 *   Queue an item again after the initial fill of the worklist.
+		 */
+		void requeue(OrderedWorklist &worklist, unsigned item) {
+			if (worklist.push(item) && DFASolverStats::Enabled)
+				Stats.Requeues++;
+		}
+
+
+		/*
+		 * Assign an index to each instruction.
+		 * The results are stored in InstrToIndex and IndexToInstr.
+		 * A dummy node (nullptr) is added. It has index 0. This node has only one outgoing edge to EntryInstr.
+		 * The information of this edge is InitialState.
+		 * Any real instruction has an index > 0.
+		 *
+		 * Direction:
+		 *   Do *NOT* change this function.
+		 *   Both forward and backward analyses must use it to assign
+		 *   indices to the instructions of a function.
+		 */
+		void assignIndiceToInstrs(Function * F) {
+
+			// Dummy instruction null has index 0;
+			// Any real instruction's index > 0.
+			InstrToIndex[nullptr] = 0;
+			IndexToInstr.push_back(nullptr);
+
+			unsigned counter = 1;
+			for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+				Instruction * instr = &*I;
+				InstrToIndex[instr] = counter;
+				IndexToInstr.push_back(instr);
+				counter++;
+			}
+
+			return;
+		}
+
+		/*
+		 * Utility function:
+		 *   Get incoming edges of the instruction identified by index.
+		 *   IncomingEdges stores the indices of the source instructions of the incoming edges.
+		 */
+		void getIncomingEdges(unsigned index, std::vector<unsigned> * IncomingEdges) {
+			assert(IncomingEdges->size() == 0 && "IncomingEdges should be empty.");
+
+			for (auto const &it : Preds[index])
+				IncomingEdges->push_back(it.first);
+
+			return;
+		}
+
+		/*
+		 * Utility function:
+		 *   Get incoming edges of the instruction identified by index.
+		 *   OutgoingEdges stores the indices of the destination instructions of the outgoing edges.
+		 */
+		void getOutgoingEdges(unsigned index, std::vector<unsigned> * OutgoingEdges) {
+			assert(OutgoingEdges->size() == 0 && "OutgoingEdges should be empty.");
+
+			for (auto const &it : Succs[index])
+				OutgoingEdges->push_back(it.first);
+
+			return;
+		}
+
+		/*
+		 * Utility function:
+		 *   Get the id of the edge src->dst, or -1 if there is no such edge.
+		 *   The cost is linear in the in-degree of dst.
+		 */
+		int getEdgeId(unsigned src, unsigned dst) {
+			for (auto const &it : Preds[dst]) {
+				if (it.first == src)
+					return it.second;
+			}
+			return -1;
+		}
+
+		/*
+		 * Utility function:
+		 *   Get the information of the edge src->dst.
+		 */
+		Info * getEdgeInfo(unsigned src, unsigned dst) {
+			int id = getEdgeId(src, dst);
+			assert(id >= 0 && "Edge does not exist.");
+			return EdgeInfos[id];
+		}
+
+		/*
+		 * Utility function:
+		 *   Insert an edge to Edges/EdgeInfos and to the adjacency lists of both ends.
+		 *   The default initial value for each edge is bottom.
+		 */
+		void addEdge(Instruction * src, Instruction * dst, Info * content) {
+			unsigned srcIndex = InstrToIndex[src];
+			unsigned dstIndex = InstrToIndex[dst];
+			if (getEdgeId(srcIndex, dstIndex) >= 0)
+				return;
+
+			unsigned id = Edges.size();
+			Edges.push_back(std::make_pair(srcIndex, dstIndex));
+			EdgeInfos.push_back(content);
+			Preds[dstIndex].push_back(std::make_pair(srcIndex, id));
+			Succs[srcIndex].push_back(std::make_pair(dstIndex, id));
+			return;
+		}
+
+		/*
+		 * Utility function:
+		 *   Sort the adjacency lists by the neighbor index, so that the edges of a node
+		 *   are visited in the same order as a scan over (source, destination) pairs.
+		 */
+		void sortAdjacencyLists() {
+			for (unsigned i = 0; i < Preds.size(); ++i) {
+				llvm::sort(Preds[i]);
+				llvm::sort(Succs[i]);
+			}
+		}
+
+		/*
+		 * Initialize the edges and EntryInstr for a forward analysis.
+		 */
+		void initializeForwardMap(Function * func) {
+			TimeTraceScope traceScope("CSE231InitEdgeMap");
+			assert(IndexToInstr.empty() && "An analysis object solves a single function once.");
+			assignIndiceToInstrs(func);
+			Preds.resize(IndexToInstr.size());
+			Succs.resize(IndexToInstr.size());
+
+			for (Function::iterator bi = func->begin(), e = func->end(); bi != e; ++bi) {
+				BasicBlock * block = &*bi;
+
+				Instruction * firstInstr = &(block->front());
+
+				// Initialize incoming edges to the basic block
+				for (auto pi = pred_begin(block), pe = pred_end(block); pi != pe; ++pi) {
+					BasicBlock * prev = *pi;
+					Instruction * src = (Instruction *)prev->getTerminator();
+					Instruction * dst = firstInstr;
+					addEdge(src, dst, &Bottom);
+				}
+
+				// If there is at least one phi node, add an edge from the first phi node
+				// to the first non-phi node instruction in the basic block.
+				if (isa<PHINode>(firstInstr)) {
+					addEdge(firstInstr, block->getFirstNonPHI(), &Bottom);
+				}
+
+				// Initialize edges within the basic block
+				for (auto ii = block->begin(), ie = block->end(); ii != ie; ++ii) {
+					Instruction * instr = &*ii;
+					if (isa<PHINode>(instr))
+						continue;
+					if (instr == (Instruction *)block->getTerminator())
+						break;
+					Instruction * next = instr->getNextNode();
+					addEdge(instr, next, &Bottom);
+				}
+
+				// Initialize outgoing edges of the basic block
+				Instruction * term = (Instruction *)block->getTerminator();
+				for (auto si = succ_begin(block), se = succ_end(block); si != se; ++si) {
+					BasicBlock * succ = *si;
+					Instruction * next = &(succ->front());
+					addEdge(term, next, &Bottom);
+				}
+
+			}
+
+			EntryInstr = (Instruction *) &((func->front()).front());
+			addEdge(nullptr, EntryInstr, &InitialState);
+			sortAdjacencyLists();
+
+			return;
+		}
+
+		/*
+		 * Direction:
+		 *   Implement the following function in part 3 for backward analyses
+		 */
+		void initializeBackwardMap(Function * func) {
+			TimeTraceScope traceScope("CSE231InitEdgeMap");
+			assert(IndexToInstr.empty() && "An analysis object solves a single function once.");
+			assignIndiceToInstrs(func);
+			Preds.resize(IndexToInstr.size());
+			Succs.resize(IndexToInstr.size());
+
+			for (Function::iterator bi = func->begin(), e = func->end(); bi != e; ++bi) {
+				BasicBlock * block = &*bi;
+
+				Instruction * firstInstr = &(block->front());
+
+				// Initialize outgoing edges to the basic block
+				for (auto pi = pred_begin(block), pe = pred_end(block); pi != pe; ++pi) {
+					BasicBlock * prev = *pi;
+					Instruction * dst = (Instruction *)prev->getTerminator();
+					Instruction * src = firstInstr;
+					addEdge(src, dst, &Bottom);
+				}
+
+				// If there is at least one phi node, add an edge from the first phi node
+				// to the first non-phi node instruction in the basic block.
+				if (isa<PHINode>(firstInstr)) {
+					addEdge(block->getFirstNonPHI(),firstInstr, &Bottom);
+				}
+
+				// Initialize edges within the basic block
+				for (auto ii = block->begin(), ie = block->end(); ii != ie; ++ii) {
+					Instruction * instr = &*ii;
+					if (isa<PHINode>(instr))
+						continue;
+					if (instr == (Instruction *)block->getTerminator())
+						break;
+					Instruction * next = instr->getNextNode();
+					addEdge(next, instr, &Bottom);
+				}
+
+				// Initialize incoming edges of the basic block
+				Instruction * term = (Instruction *)block->getTerminator();
+				for (auto si = succ_begin(block), se = succ_end(block); si != se; ++si) {
+					BasicBlock * succ = *si;
+					Instruction * next = &(succ->front());
+					addEdge(next, term, &Bottom);
+				}
+
+			}
+
+			EntryInstr = (Instruction *) &((func->back()).back());
+			addEdge(nullptr, EntryInstr, &InitialState);
+			sortAdjacencyLists();
+
+			return;
+
+		}
+
+		/*
+		 * Utility function:
+		 *   An edge is a block boundary edge if it leaves the last node of a basic
+		 *   block in visiting order (including the dummy edge from node 0), even when
+		 *   it goes back to the same block, as the back edge of a single-block loop
+		 *   does. In block granularity mode only these edges keep their information
+		 *   across worklist iterations.
+		 */
+		bool isBoundaryEdge(unsigned id) {
+			unsigned src = Edges[id].first;
+			return src == 0 || src == BlockNodes[NodeToBlock[src]].back();
+		}
+
+		/*
+		 * Group the nodes by basic block, in visiting order.
+		 * A block starting with phi instructions is represented by its first phi node.
+		 */
+		void assignNodesToBlocks(Function * func) {
+			NodeToBlock.assign(IndexToInstr.size(), ~0u);
+			BlockNodes.clear();
+			BlockToIndex.clear();
+
+			for (BasicBlock &block : *func) {
+				unsigned blockId = BlockNodes.size();
+				BlockToIndex[&block] = blockId;
+				BlockNodes.emplace_back();
+				std::vector<unsigned> &nodes = BlockNodes.back();
+
+				if (isa<PHINode>(&block.front()))
+					nodes.push_back(InstrToIndex[&block.front()]);
+				for (Instruction &instr : block) {
+					if (!isa<PHINode>(&instr))
+						nodes.push_back(InstrToIndex[&instr]);
+				}
+				if (!Direction)
+					std::reverse(nodes.begin(), nodes.end());
+
+				for (unsigned node : nodes)
+					NodeToBlock[node] = blockId;
+			}
+		}
+
+		/*
+		 * Compute the order in which basic blocks are taken from the worklist:
+		 * reverse postorder of the CFG for a forward analysis, and reverse postorder
+		 * of the reverse CFG (starting from the blocks without successors) for a
+		 * backward analysis. Blocks the traversal does not reach are appended in layout order.
+		 */
+		std::vector<unsigned> computeBlockOrder(Function * func) {
+			std::vector<unsigned> postOrder;
+			BitVector visited(BlockNodes.size());
+			// Stack of (block, next neighbor position)
+			std::vector<std::pair<BasicBlock *, unsigned>> stack;
+
+			auto numNeighbors = [](BasicBlock * block) -> unsigned {
+				return Direction ? succ_size(block) : pred_size(block);
+			};
+			auto neighbor = [](BasicBlock * block, unsigned i) -> BasicBlock * {
+				return Direction ? *std::next(succ_begin(block), i) : *std::next(pred_begin(block), i);
+			};
+			auto traverse = [&](BasicBlock * root) {
+				if (visited.test(BlockToIndex[root]))
+					return;
+				visited.set(BlockToIndex[root]);
+				stack.push_back(std::make_pair(root, 0u));
+				while (!stack.empty()) {
+					BasicBlock * block = stack.back().first;
+					unsigned i = stack.back().second;
+					if (i == numNeighbors(block)) {
+						postOrder.push_back(BlockToIndex[block]);
+						stack.pop_back();
+						continue;
+					}
+					stack.back().second++;
+					BasicBlock * next = neighbor(block, i);
+					if (!visited.test(BlockToIndex[next])) {
+						visited.set(BlockToIndex[next]);
+						stack.push_back(std::make_pair(next, 0u));
+					}
+				}
+			};
+
+			if (Direction) {
+				traverse(&func->front());
+			} else {
+				for (BasicBlock &block : *func) {
+					if (succ_empty(&block))
+						traverse(&block);
+				}
+			}
+
+			std::vector<unsigned> order(postOrder.rbegin(), postOrder.rend());
+			for (unsigned i = 0; i < BlockNodes.size(); ++i) {
+				if (!visited.test(i))
+					order.push_back(i);
+			}
+			return order;
+		}
+
+		/*
+		 * Utility function:
+		 *   With -time-trace, cut the solve into CSE231WorklistSample events of
+		 *   TraceSampleInterval iterations each, whose detail is the worklist size
+		 *   at their start. Called before each pop; endWorklistSamples closes the last one.
+		 */
+		static const unsigned TraceSampleInterval = 1024;
+
+		void sampleWorklist(const OrderedWorklist &worklist) {
+			if (NumWorklistIterations % TraceSampleInterval != 0 || !timeTraceProfilerEnabled())
+				return;
+			if (NumWorklistIterations != 0)
+				timeTraceProfilerEnd();
+			timeTraceProfilerBegin("CSE231WorklistSample", [&]() {
+				return "size " + std::to_string(worklist.size()) + ", iteration " + std::to_string(NumWorklistIterations);
+			});
+		}
+
+		void endWorklistSamples() {
+			if (NumWorklistIterations != 0 && timeTraceProfilerEnabled())
+				timeTraceProfilerEnd();
+		}
+
+		/*
+		 * Apply the flow functions of a basic block in sequence.
+		 * The information of the edges inside the block is produced into scratch
+		 * objects consumed by the next node; block boundary edges are joined with
+		 * their old information and, if they change, the destination block is
+		 * pushed into the worklist.
+		 * With keep set, the block is swept once more with the final boundary
+		 * information and the inner edges keep their results (used by materializeEdgeInfos).
+		 */
+		void sweepBlock(unsigned blockId, bool keep, OrderedWorklist &worklist) {
+			std::vector<Info *> scratch;
+
+			for (unsigned nodeIndex : BlockNodes[blockId]) {
+				std::vector<unsigned> inComingEdges;
+				getIncomingEdges(nodeIndex, &inComingEdges);
+				std::vector<unsigned> outGoingEdges;
+				getOutgoingEdges(nodeIndex, &outGoingEdges);
+
+				std::vector<Info *> InfoOut;
+				for (unsigned i = 0; i < outGoingEdges.size(); ++i)
+					InfoOut.push_back(Pool.create());
+				applyFlowFunction(nodeIndex, inComingEdges, outGoingEdges, InfoOut);
+
+				for (unsigned i = 0; i < outGoingEdges.size(); ++i) {
+					unsigned edgeId = Succs[nodeIndex][i].second;
+					if (!isBoundaryEdge(edgeId)) {
+						EdgeInfos[edgeId] = InfoOut[i];
+						if (!keep)
+							scratch.push_back(InfoOut[i]);
+						continue;
+					}
+
+					if (keep)
+						Pool.recycle(InfoOut[i]);
+					else if (joinIntoEdge(edgeId, InfoOut[i]))
+						requeue(worklist, NodeToBlock[outGoingEdges[i]]);
+				}
+			}
+
+			// The inner edges go back to bottom until the next sweep of this block
+			for (Info * info : scratch)
+				Pool.recycle(info);
+			if (!keep) {
+				for (unsigned nodeIndex : BlockNodes[blockId]) {
+					for (auto const &it : Succs[nodeIndex]) {
+						if (!isBoundaryEdge(it.second))
+							EdgeInfos[it.second] = &Bottom;
+					}
+				}
+			}
+		}
+
+		/*
+		 * The worklist algorithm at basic block granularity.
+		 * The worklist holds block ids; visiting a block applies its composed flow function.
+		 */
+		void runBlockWorklistAlgorithm(Function * func) {
+			std::vector<unsigned> blockOrder = computeBlockOrder(func);
+
+			OrderedWorklist worklist;
+			worklist.init(blockOrder, BlockNodes.size());
+			for (unsigned blockId : blockOrder)
+				worklist.push(blockId);
+
+			while (!worklist.empty()) {
+				sampleWorklist(worklist);
+				unsigned blockId = worklist.pop();
+				countVisit(blockId);
+				sweepBlock(blockId, false, worklist);
+			}
+			endWorklistSamples();
+			Materialized = false;
+		}
+
+    /*
+     * The flow function.
+     *   Instruction I: the IR instruction to be processed.
+     *   std::vector<unsigned> & IncomingEdges: the vector of the indices of the source instructions of the incoming edges.
+     *   std::vector<unsigned> & IncomingEdges: the vector of indices of the source instructions of the outgoing edges.
+     *   std::vector<Info *> & Infos: the vector of the newly computed information for each outgoing edges.
+     *
+     * Direction:
+     * 	 Implement this function in subclasses.
+     */
+    virtual void flowfunction(Instruction * I,std::vector<unsigned> & IncomingEdges,std::vector<unsigned> & OutgoingEdges,std::vector<Info *> & Infos) = 0;
+
+  private:
+		// The class whose flow function the solver calls, see Derived
+		typedef typename std::conditional<std::is_void<Derived>::value, DataFlowAnalysis, Derived>::type FlowFunctionOwner;
+
+		void applyFlowFunction(unsigned nodeIndex, std::vector<unsigned> & IncomingEdges, std::vector<unsigned> & OutgoingEdges, std::vector<Info *> & Infos) {
+			static_cast<FlowFunctionOwner *>(this)->flowfunction(IndexToInstr[nodeIndex], IncomingEdges, OutgoingEdges, Infos);
+			NumFlowFunctionCalls++;
+		}
+
+  public:
+    DataFlowAnalysis(Info & bottom, Info & initialState) : Bottom(bottom), InitialState(initialState),EntryInstr(nullptr),BlockGranularity(false),Materialized(true),NumWorklistIterations(0),NumFlowFunctionCalls(0) {}
+
+    DataFlowAnalysis(const DataFlowAnalysis &) = delete;
+    DataFlowAnalysis &operator=(const DataFlowAnalysis &) = delete;
+
+    virtual ~DataFlowAnalysis() {}
+
+    /*
+     * Rebuild the information of the edges inside basic blocks after a solve at
+     * basic block granularity. Does nothing if they are already up to date.
+     */
+    void materializeEdgeInfos() {
+			if (Materialized)
+				return;
+
+			TimeTraceScope traceScope("CSE231MaterializeEdges");
+			OrderedWorklist worklist;
+			for (unsigned i = 0; i < BlockNodes.size(); ++i)
+				sweepBlock(i, true, worklist);
+			Materialized = true;
+    }
+
+    /*
+     * Statistics of the last runWorklistAlgorithm call.
+     */
+    unsigned getNumWorklistIterations() const { return NumWorklistIterations; }
+    unsigned getNumFlowFunctionCalls() const { return NumFlowFunctionCalls; }
+    unsigned getNumInfosAllocated() const { return Pool.getNumAllocated(); }
+    const DFASolverStats &getSolverStats() const { return Stats; }
+
+    /*
+     * Queries on the results of runWorklistAlgorithm, for the passes that use
+     * them instead of printing them.
+     * Indices are those of assignIndiceToInstrs, which the index sets of the
+     * facts refer to. Edges go in the direction of the analysis, and the edge
+     * entering EntryInstr comes from nullptr.
+     */
+    unsigned getNumNodes() const { return IndexToInstr.size(); }
+    Instruction * getInstruction(unsigned index) const { return IndexToInstr[index]; }
+
+    int getIndex(Instruction * I) const {
+    	auto it = InstrToIndex.find(I);
+    	return it == InstrToIndex.end() ? -1 : (int)it->second;
+    }
+
+    /*
+     * The information of the edge src->dst, or nullptr if there is no such edge.
+     */
+    Info * getInfo(Instruction * src, Instruction * dst) {
+    	int srcIndex = getIndex(src), dstIndex = getIndex(dst);
+    	if (srcIndex < 0 || dstIndex < 0)
+    		return nullptr;
+    	int id = getEdgeId(srcIndex, dstIndex);
+    	if (id < 0)
+    		return nullptr;
+    	materializeEdgeInfos();
+    	return EdgeInfos[id];
+    }
+
+    /*
+     * Print out the analysis results.
+     *
+     * Direction:
+     * 	 Do not change this funciton.
+     * 	 The autograder will check the output of this function.
+     */
+    void print() {
+			print(errs());
+    }
+
+    /*
+     * Print out the analysis results to OS, in the format chosen by -cse231-output-format.
+     */
+    void print(raw_ostream &OS) {
+			materializeEdgeInfos();
+			TimeTraceScope traceScope("CSE231Print");
+
+			// Print the edges ordered by (source, destination)
+			std::vector<unsigned> order(Edges.size());
+			for (unsigned i = 0; i < order.size(); ++i)
+				order[i] = i;
+			llvm::sort(order, [this](unsigned a, unsigned b) { return Edges[a] < Edges[b]; });
+
+			if (DFAOutputFormat == DFABinaryOutput) {
+				cse231result::FunctionWriter W(EntryInstr->getFunction()->getName());
+				for (unsigned id : order) {
+					W.beginEdge(Edges[id].first, Edges[id].second);
+					EdgeInfos[id]->write(W);
+				}
+				OS << W.finish();
+				return;
+			}
+
+			for (unsigned id : order) {
+				OS << "Edge " << Edges[id].first << "->" "Edge " << Edges[id].second << ":";
+				EdgeInfos[id]->print(OS);
+			}
+    }
+
+    /*
+     * Solve at basic block granularity.
+     * Only the edges entering and leaving basic blocks keep information while the
+     * worklist runs; the edges inside a block are rebuilt by materializeEdgeInfos
+     * when they are needed. Must be called before runWorklistAlgorithm.
+     */
+    void setBlockGranularity(bool enable) {
+			BlockGranularity = enable;
+    }
+
+    /*
+     * This function implements the work list algorithm in the following steps:
+     * (1) Initialize info of each edge to bottom
+     * (2) Initialize the worklist
+     * (3) Compute until the worklist is empty
+     *
+     * Direction:
+     *   Implement the rest of the function.
+     *   You may not change anything before "// (2) Initialize the worklist".
+     */
+    void runWorklistAlgorithm(Function * func) {
+    	OrderedWorklist worklist;
+
+    	// (1) Initialize info of each edge to bottom
+    	if (Direction)
+    		initializeForwardMap(func);
+    	else
+    		initializeBackwardMap(func);
+
+    	assert(EntryInstr != nullptr && "Entry instruction is null.");
+
+    	// (2) Initialize the work list
+		assignNodesToBlocks(func);
+		TimeTraceScope traceScope("CSE231WorklistSolve");
+
+		if (BlockGranularity) {
+			if (DFASolverStats::Enabled)
+				Stats.VisitsPerNode.assign(BlockNodes.size(), 0);
+			runBlockWorklistAlgorithm(func);
+			finishSolverStats();
+			return;
+		}
+		if (DFASolverStats::Enabled)
+			Stats.VisitsPerNode.assign(IndexToInstr.size(), 0);
+
+		// Nodes are ordered by the reverse postorder of their blocks (of the reverse CFG
+		// for a backward analysis), then by their visiting order inside the block.
+		// Since we deal all Phi instructions as a whole node, only the first phi instruction of a block is a node.
+		std::vector<unsigned> nodeOrder;
+		for (unsigned blockId : computeBlockOrder(func))
+			nodeOrder.insert(nodeOrder.end(), BlockNodes[blockId].begin(), BlockNodes[blockId].end());
+		worklist.init(nodeOrder, IndexToInstr.size());
+		for (unsigned nodeIndex : nodeOrder)
+			worklist.push(nodeIndex);
+
+    	// (3) Compute until the work list is empty
+		while(!worklist.empty()){		//Iterate until the worklist becomes empty
+			sampleWorklist(worklist);
+			unsigned nodeIndex=worklist.pop();	//Get and pop the queued node that comes first in the visiting order
+			countVisit(nodeIndex);
+
+			std::vector<unsigned> inComingEdges;
+			getIncomingEdges(nodeIndex,&inComingEdges);
+			std::vector<unsigned> outGoingEdges;
+			getOutgoingEdges(nodeIndex,&outGoingEdges);
+
+			std::vector<Info*> InfoOut;
+			for(unsigned i=0;i<outGoingEdges.size();++i){
+				InfoOut.push_back(Pool.create());
+			}
+			applyFlowFunction(nodeIndex,inComingEdges,outGoingEdges,InfoOut);		//Use the flowfunction to process all Infos on incomingEdges and node and generate the output Info for outgoingEdges
+			for(unsigned i=0;i<outGoingEdges.size();i++){	//Iterate through all outgoingEdges
+				unsigned dstIndex=outGoingEdges[i];
+				unsigned edgeId=Succs[nodeIndex][i].second;
+
+				//Join the output of flowfunction into the info of this outgoingEdge. If it changed, the edge hasn't reached fixed point, add its destination back to the worklist (unless it is already queued).
+				if(joinIntoEdge(edgeId,InfoOut[i]))
+					requeue(worklist,dstIndex);
+			}
+		}
+		endWorklistSamples();
+		finishSolverStats();
+    }
+
+  private:
+    void finishSolverStats() {
+    	Stats.NodeVisits = NumWorklistIterations;
+    	Stats.FlowFunctionCalls = NumFlowFunctionCalls;
+    	if (DFASolverStats::Enabled)
+    		Stats.InfoBytes = uint64_t(Pool.getNumAllocated()) * sizeof(Info);
+    }
+};
+
+
+
+}
+#endif // End LLVM_231DFA_H
+
@@ -0,0 +1,108 @@
+//===- ReachingDefinitionAnalysis.h - Reaching definition analysis ---*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file provides the reaching definition analysis of CSE 231 part 2.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_231REACHINGDEFINITIONANALYSIS_H
+#define LLVM_TRANSFORMS_231REACHINGDEFINITIONANALYSIS_H
+
+#include "231DFA.h"
+#include "llvm/IR/Instructions.h"
+#include <vector>
+
+namespace llvm {
+
+    //define a subclass of Info: ReachingInfo
+    class ReachingInfo final: public Info 
+    {
+        public:
+            //Use a bit vector indexed by instruction index to contain the reaching definition of each edge
+            FactBitVector reachingDefs;
+
+            ReachingInfo(){}
+            ReachingInfo(const ReachingInfo &other):Info(other){
+                reachingDefs=other.reachingDefs;
+            }
+            ReachingInfo& operator=(const ReachingInfo &other){
+                reachingDefs=other.reachingDefs;
+                return *this;
+            }
+            //Implement virtual function of parent class to print reaching definition
+            void print(raw_ostream &OS) override{
+                reachingDefs.forEach([&OS](unsigned index){
+                    OS<<index<<"|";
+                });
+                OS<<"\n";
+            }
+            void write(cse231result::FunctionWriter &W) override{
+                std::vector<unsigned> indices;
+                reachingDefs.forEach([&indices](unsigned index){
+                    indices.push_back(index);
+                });
+                W.writeIndexSet(indices);
+            }
+            unsigned size() override{
+                return reachingDefs.count();
+            }
+            //Implement equal function 
+            static bool equals(ReachingInfo* info1, ReachingInfo* info2){
+                return info1->reachingDefs==info2->reachingDefs;
+            }
+            //Implement join() function as a word-wise OR; result keeps its own content, as with an inserter into it
+            static ReachingInfo* join(ReachingInfo* info1, ReachingInfo* info2, ReachingInfo* result){
+                result->reachingDefs|=info1->reachingDefs;
+                result->reachingDefs|=info2->reachingDefs;
+                return result;
+            }
+            //Implement joinInto() function as a word-wise OR that reports a change
+            static bool joinInto(ReachingInfo* src, ReachingInfo* dst){
+                return dst->reachingDefs.unionWith(src->reachingDefs);
+            }
+    };
+    //define a subclass of DataFlowAnalysis: ReachingDefinitionAnalysis
+    class ReachingDefinitionAnalysis final: public DataFlowAnalysis<ReachingInfo,true,ReachingDefinitionAnalysis> {
+        private:
+            //The solver calls flowfunction statically, see DataFlowAnalysis
+            friend class DataFlowAnalysis<ReachingInfo,true,ReachingDefinitionAnalysis>;
+            //Implement flowfunction to process three types of instructions
+            void flowfunction(Instruction * I,std::vector<unsigned> & IncomingEdges,std::vector<unsigned> & OutgoingEdges,std::vector<ReachingInfo *> & InfoOut) override{
+                unsigned nodeIndex=InstrToIndex[I];
+                // 1st type is instruction that define a variable in IR code, 2nd type is instruction that doesn't define variable, 3rd type is phi instruction (specifically all successive phi instructions are condiered as a whole node, which means this type of instruction will define many variables "at the same time")   
+                InstrKind instrType=classifyInstr(I);
+                //Join all infos on all incomingEdges
+                ReachingInfo AllInfoIn;
+                for(auto edgeIndex: IncomingEdges){
+                    ReachingInfo* tmpInfo=getEdgeInfo(edgeIndex,nodeIndex);
+                    ReachingInfo::join(&AllInfoIn,tmpInfo,&AllInfoIn);
+                }
+                //if it's 1st type instruction, then add the index of this instruction to the set of incoming information
+                if(DefInstr==instrType){
+                    AllInfoIn.reachingDefs.set(nodeIndex);
+                }else if(PhiInstr==instrType){         //if it's 3rd type instruction, join the set of all successive phi instructions with the set of incoming information
+                    BasicBlock * parentBlock=I->getParent();    //get the block that the first phi instruction belongs to
+                    unsigned nonPhiIndex=InstrToIndex[parentBlock->getFirstNonPHI()];       //get the index of the first Non-phi instruction
+                    for(unsigned i=nodeIndex;i<nonPhiIndex;i++){    //Add all indices between them to the incoming information set
+                        AllInfoIn.reachingDefs.set(i);
+                    }
+                }
+                //put the output reachingInfo to the result container of every outgoing edge
+                for(unsigned i=0;i<InfoOut.size();++i){
+                    InfoOut[i]->reachingDefs=AllInfoIn.reachingDefs;
+                }
+            }
+        public:
+            //the constructor which explicitly call the constructor of parent class
+            ReachingDefinitionAnalysis(ReachingInfo& bottom, ReachingInfo& initialState):DataFlowAnalysis(bottom,initialState){}
+    };
+
+} // namespace llvm
+
+#endif
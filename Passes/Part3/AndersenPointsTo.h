@@ -0,0 +1,419 @@
+//===- AndersenPointsTo.h - Flow-insensitive may-point-to analysis -------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file provides an inclusion-based (Andersen style) points-to analysis
+// over the pointers of MayPointToAnalysis. It is flow-insensitive: one
+// points-to set per pointer for the whole function, which contains what the
+// flow-sensitive analysis finds on any of its edges.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_231ANDERSENPOINTSTO_H
+#define LLVM_TRANSFORMS_231ANDERSENPOINTSTO_H
+
+#include "231DFA.h"
+#include "MayPointToAnalysis.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/SparseBitVector.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/TimeProfiler.h"
+#include <string>
+#include <vector>
+
+namespace llvm {
+
+/*
+ * The pointers are the PtrIDs of MayPointToAnalysis, with its conventions:
+ * operands that are not instructions are ('R', 0), which points to nothing,
+ * and the phis of a block all flow into the pointer of the first one.
+ *
+ * The constraints of a function become a graph with one node per pointer:
+ * copy edges for the assignments between pointers (bitcast, getelementptr, select,
+ * phi), and load and store constraints that add copy edges as the points-to
+ * set of their address grows. Points-to sets are SparseBitVectors of the
+ * indices of the 'M' pointers. The worklist solver propagates only what a
+ * node gained since its last visit (difference propagation), and collapses
+ * the cycles of the graph into one node as it finds them: an edge whose ends
+ * have equal sets after a propagation is a hint of a cycle, which a Tarjan
+ * search from it confirms (lazy cycle detection).
+ */
+class AndersenPointsTo {
+  public:
+    AndersenPointsTo() : Func(nullptr), NumIndices(0), NumCollapsed(0), NumPropagations(0) {}
+    AndersenPointsTo(const AndersenPointsTo &) = delete;
+    AndersenPointsTo &operator=(const AndersenPointsTo &) = delete;
+
+    /*
+     * Solve the constraints of F. Any previous result is dropped.
+     */
+    void solve(Function *F) {
+      TimeTraceScope traceScope("CSE231AndersenSolve");
+      Func = F;
+      IndexToInstr.assign(1, nullptr);
+      InstrToIndex.clear();
+      for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+        InstrToIndex[&*I] = IndexToInstr.size();
+        IndexToInstr.push_back(&*I);
+      }
+      NumIndices = IndexToInstr.size();
+      unsigned numNodes = 2 * NumIndices;
+      Rep.resize(numNodes);
+      for (unsigned node = 0; node < numNodes; ++node)
+        Rep[node] = node;
+      Pts.assign(numNodes, SparseBitVector<>());
+      Done.assign(numNodes, SparseBitVector<>());
+      Copies.assign(numNodes, SparseBitVector<>());
+      Loads.assign(numNodes, SmallVector<unsigned, 1>());
+      Stores.assign(numNodes, SmallVector<unsigned, 1>());
+      CheckedEdges.clear();
+      InWorklist.assign(numNodes, false);
+      Worklist.clear();
+      NumCollapsed = 0;
+      NumPropagations = 0;
+
+      addConstraints();
+      for (unsigned node = 0; node < numNodes; ++node) {
+        if (!Pts[node].empty())
+          push(node);
+      }
+      while (!Worklist.empty()) {
+        unsigned node = Worklist.back();
+        Worklist.pop_back();
+        InWorklist[node] = false;
+        if (find(node) == node)
+          propagate(node);
+      }
+
+      //every node points at its representative, so that the queries need no find()
+      for (unsigned node = 0; node < numNodes; ++node)
+        Rep[node] = find(node);
+      Done.clear();
+      CheckedEdges.clear();
+    }
+
+    /*
+     * The 'M' pointers p may point to, by index.
+     */
+    const SparseBitVector<> &getPointsTo(PtrID p) const { return Pts[Rep[getNode(p)]]; }
+
+    bool mayPointTo(PtrID p, PtrID target) const {
+      return target.first == 'M' && getPointsTo(p).test(target.second);
+    }
+
+    /*
+     * Whether p and q may point to the same memory.
+     */
+    bool mayAlias(PtrID p, PtrID q) const { return getPointsTo(p).intersects(getPointsTo(q)); }
+
+    /*
+     * Number of nodes merged into another one by cycle elimination, and of
+     * points-to set unions along copy edges, in the last solve.
+     */
+    unsigned getNumCollapsed() const { return NumCollapsed; }
+    unsigned getNumPropagations() const { return NumPropagations; }
+
+    /*
+     * Print in the format of MayPointToDefinitionAnalysis: every edge of its
+     * CFG carries the points-to sets of the whole function.
+     */
+    void print(raw_ostream &OS) {
+      TimeTraceScope traceScope("CSE231Print");
+      MayPointToInfo info;
+      info.Sets = std::make_shared<PointsToSetTable>();
+      for (char kind : {'M', 'R'}) {
+        for (unsigned index = 0; index < NumIndices; ++index) {
+          const SparseBitVector<> &set = getPointsTo(PtrID(kind, index));
+          if (set.empty())
+            continue;
+          std::vector<PtrID> targets;
+          for (unsigned target : set)
+            targets.push_back(PtrID('M', target));
+          info.set(PtrID(kind, index), info.Sets->intern(std::move(targets)));
+        }
+      }
+
+      if (DFAOutputFormat == DFABinaryOutput) {
+        cse231result::FunctionWriter W(Func->getName());
+        forEachEdge([&](unsigned src, unsigned dst) {
+          W.beginEdge(src, dst);
+          info.write(W);
+        });
+        OS << W.finish();
+        return;
+      }
+      //the fact is the same on every edge, format it once
+      std::string fact;
+      raw_string_ostream factOS(fact);
+      info.print(factOS);
+      factOS.flush();
+      forEachEdge([&](unsigned src, unsigned dst) {
+        OS << "Edge " << src << "->" "Edge " << dst << ":" << fact;
+      });
+    }
+
+  private:
+    unsigned getNode(PtrID p) const { return p.first == 'M' ? NumIndices + p.second : p.second; }
+
+    unsigned getIndex(Value *v) const {
+      Instruction *instr = dyn_cast<Instruction>(v);
+      return instr ? InstrToIndex.lookup(instr) : 0;
+    }
+
+    unsigned find(unsigned node) {
+      while (Rep[node] != node) {
+        Rep[node] = Rep[Rep[node]];
+        node = Rep[node];
+      }
+      return node;
+    }
+
+    void push(unsigned node) {
+      if (!InWorklist[node]) {
+        InWorklist[node] = true;
+        Worklist.push_back(node);
+      }
+    }
+
+    /*
+     * The constraints of the flow functions of MayPointToDefinitionAnalysis.
+     */
+    void addConstraints() {
+      for (unsigned index = 1; index < NumIndices; ++index) {
+        Instruction *I = IndexToInstr[index];
+        switch (I->getOpcode()) {
+        case Instruction::Alloca:
+          Pts[index].set(index);
+          break;
+        case Instruction::BitCast:
+          addCopy(getIndex(I->getOperand(0)), index);
+          break;
+        case Instruction::GetElementPtr:
+          addCopy(getIndex(cast<GetElementPtrInst>(I)->getPointerOperand()), index);
+          break;
+        case Instruction::Load:
+          Loads[getIndex(cast<LoadInst>(I)->getPointerOperand())].push_back(index);
+          break;
+        case Instruction::Store: {
+          StoreInst *store = cast<StoreInst>(I);
+          Stores[getIndex(store->getPointerOperand())].push_back(getIndex(store->getValueOperand()));
+          break;
+        }
+        case Instruction::Select:
+          addCopy(getIndex(cast<SelectInst>(I)->getTrueValue()), index);
+          addCopy(getIndex(cast<SelectInst>(I)->getFalseValue()), index);
+          break;
+        case Instruction::PHI: {
+          unsigned firstPhi = InstrToIndex.lookup(&I->getParent()->front());
+          for (Value *incoming : cast<PHINode>(I)->incoming_values())
+            addCopy(getIndex(incoming), firstPhi);
+          break;
+        }
+        default:
+          break;
+        }
+      }
+    }
+
+    /*
+     * Add the edge src -> dst, Pts(src) is included in Pts(dst).
+     */
+    void addCopy(unsigned src, unsigned dst) {
+      src = find(src);
+      dst = find(dst);
+      if (src == dst || !Copies[src].test_and_set(dst))
+        return;
+      NumPropagations++;
+      if (Pts[dst] |= Pts[src])
+        push(dst);
+    }
+
+    /*
+     * Visit a representative node: resolve its load and store constraints for
+     * the targets it gained, and pass them along its copy edges.
+     */
+    void propagate(unsigned node) {
+      SparseBitVector<> delta;
+      delta.intersectWithComplement(Pts[node], Done[node]);
+      if (delta.empty())
+        return;
+      Done[node] |= delta;
+
+      for (unsigned target : delta) {
+        unsigned targetNode = NumIndices + target;
+        for (unsigned i = 0; i < Loads[node].size(); ++i)
+          addCopy(targetNode, Loads[node][i]);
+        for (unsigned i = 0; i < Stores[node].size(); ++i)
+          addCopy(Stores[node][i], targetNode);
+      }
+      //the constraints may have merged node into a cycle
+      if (find(node) != node) {
+        push(find(node));
+        return;
+      }
+
+      SmallVector<unsigned, 4> cycleHints;
+      SmallVector<unsigned, 8> succs;
+      for (unsigned succ : Copies[node])
+        succs.push_back(succ);
+      for (unsigned succ : succs) {
+        succ = find(succ);
+        if (succ == node)
+          continue;
+        NumPropagations++;
+        if (Pts[succ] |= delta)
+          push(succ);
+        else if (Pts[succ] == Pts[node] && CheckedEdges.insert(std::make_pair(node, succ)).second)
+          cycleHints.push_back(succ);
+      }
+      for (unsigned hint : cycleHints) {
+        if (find(hint) == hint)
+          collapseCycles(hint);
+      }
+    }
+
+    /*
+     * Merge node into root.
+     */
+    void unite(unsigned root, unsigned node) {
+      Rep[node] = root;
+      NumCollapsed++;
+      Pts[root] |= Pts[node];
+      //a target is done for the merged node only if it was done for both
+      Done[root] &= Done[node];
+      Copies[root] |= Copies[node];
+      Loads[root].append(Loads[node].begin(), Loads[node].end());
+      Stores[root].append(Stores[node].begin(), Stores[node].end());
+      Pts[node].clear();
+      Done[node].clear();
+      Copies[node].clear();
+      Loads[node].clear();
+      Stores[node].clear();
+      push(root);
+    }
+
+    /*
+     * Tarjan's algorithm from start over the copy edges, collapsing every
+     * strongly connected component it finds.
+     */
+    void collapseCycles(unsigned start) {
+      struct Frame {
+        unsigned node;
+        SmallVector<unsigned, 4> succs;
+        unsigned next;
+      };
+      DenseMap<unsigned, unsigned> dfsNum;
+      std::vector<unsigned> low;
+      std::vector<unsigned> sccStack;
+      DenseSet<unsigned> onStack;
+      std::vector<Frame> frames;
+
+      auto visit = [&](unsigned node) {
+        dfsNum[node] = low.size();
+        low.push_back(low.size());
+        sccStack.push_back(node);
+        onStack.insert(node);
+        frames.emplace_back();
+        frames.back().node = node;
+        frames.back().next = 0;
+        for (unsigned succ : Copies[node]) {
+          succ = find(succ);
+          if (succ != node)
+            frames.back().succs.push_back(succ);
+        }
+      };
+
+      visit(start);
+      while (!frames.empty()) {
+        Frame &frame = frames.back();
+        unsigned num = dfsNum[frame.node];
+        if (frame.next < frame.succs.size()) {
+          unsigned succ = frame.succs[frame.next++];
+          auto it = dfsNum.find(succ);
+          if (it == dfsNum.end())
+            visit(succ);
+          else if (onStack.count(succ))
+            low[num] = std::min(low[num], it->second);
+          continue;
+        }
+
+        unsigned node = frame.node;
+        frames.pop_back();
+        if (!frames.empty()) {
+          unsigned parentNum = dfsNum[frames.back().node];
+          low[parentNum] = std::min(low[parentNum], low[num]);
+        }
+        if (low[num] != num)
+          continue;
+        while (true) {
+          unsigned member = sccStack.back();
+          sccStack.pop_back();
+          onStack.erase(member);
+          if (member == node)
+            break;
+          unite(node, member);
+        }
+      }
+    }
+
+    /*
+     * Call f on the edges of the CFG of MayPointToDefinitionAnalysis, ordered
+     * by (source, destination) as its print() orders them.
+     */
+    template <typename Fn>
+    void forEachEdge(Fn f) {
+      f(0, InstrToIndex.lookup(&Func->front().front()));
+      std::vector<unsigned> succFronts;
+      for (BasicBlock &block : *Func) {
+        unsigned nonPhiIndex = InstrToIndex.lookup(block.getFirstNonPHI());
+        if (isa<PHINode>(&block.front()))
+          f(InstrToIndex.lookup(&block.front()), nonPhiIndex);
+        unsigned termIndex = InstrToIndex.lookup(block.getTerminator());
+        for (unsigned index = nonPhiIndex; index < termIndex; ++index)
+          f(index, index + 1);
+
+        succFronts.clear();
+        for (BasicBlock *succ : successors(&block))
+          succFronts.push_back(InstrToIndex.lookup(&succ->front()));
+        llvm::sort(succFronts);
+        succFronts.erase(std::unique(succFronts.begin(), succFronts.end()), succFronts.end());
+        for (unsigned front : succFronts)
+          f(termIndex, front);
+      }
+    }
+
+    Function *Func;
+    std::vector<Instruction *> IndexToInstr;
+    DenseMap<Instruction *, unsigned> InstrToIndex;
+    // Number of instruction indices; node i is ('R', i) and node NumIndices + i is ('M', i)
+    unsigned NumIndices;
+    // Union-find forest of the collapsed cycles
+    std::vector<unsigned> Rep;
+    // Points-to set of each representative, and the part of it already propagated
+    std::vector<SparseBitVector<>> Pts;
+    std::vector<SparseBitVector<>> Done;
+    // Copy edges, Loads[p]: the nodes loaded from *p, Stores[p]: the nodes stored to *p
+    std::vector<SparseBitVector<>> Copies;
+    std::vector<SmallVector<unsigned, 1>> Loads;
+    std::vector<SmallVector<unsigned, 1>> Stores;
+    // Copy edges already searched for a cycle
+    DenseSet<std::pair<unsigned, unsigned>> CheckedEdges;
+    std::vector<bool> InWorklist;
+    std::vector<unsigned> Worklist;
+    unsigned NumCollapsed;
+    unsigned NumPropagations;
+};
+
+} // namespace llvm
+
+#endif
@@ -0,0 +1,135 @@
+//===- LivenessAnalysis.h - Liveness analysis -------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file provides the liveness analysis of CSE 231 part 3.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_231LIVENESSANALYSIS_H
+#define LLVM_TRANSFORMS_231LIVENESSANALYSIS_H
+
+#include "231DFA.h"
+#include "llvm/IR/Instructions.h"
+#include <vector>
+
+namespace llvm {
+
+    //define a subclass of Info: LivenessInfo
+    class LivenessInfo final: public Info
+    {
+        public:
+            //Use a bit vector indexed by instruction index to contain the live variables of each edge
+            FactBitVector LivenessDefs;
+
+            LivenessInfo(){}
+            LivenessInfo(const LivenessInfo &other):Info(other){
+                LivenessDefs=other.LivenessDefs;
+            }
+            LivenessInfo& operator=(const LivenessInfo &other){
+                LivenessDefs=other.LivenessDefs;
+                return *this;
+            }
+            //Implement virtual function of parent class to print reaching definition
+            void print(raw_ostream &OS) override{
+                LivenessDefs.forEach([&OS](unsigned index){
+                    OS<<index<<"|";
+                });
+                OS<<"\n";
+            }
+            void write(cse231result::FunctionWriter &W) override{
+                std::vector<unsigned> indices;
+                LivenessDefs.forEach([&indices](unsigned index){
+                    indices.push_back(index);
+                });
+                W.writeIndexSet(indices);
+            }
+            unsigned size() override{
+                return LivenessDefs.count();
+            }
+            //Implement equal function 
+            static bool equals(LivenessInfo* info1, LivenessInfo* info2){
+                return info1->LivenessDefs==info2->LivenessDefs;
+            }
+            //Implement join() function as a word-wise OR; result keeps its own content, as with an inserter into it
+            static LivenessInfo* join(LivenessInfo* info1, LivenessInfo* info2, LivenessInfo* result){
+                result->LivenessDefs|=info1->LivenessDefs;
+                result->LivenessDefs|=info2->LivenessDefs;
+                return result;
+            }
+            //Implement joinInto() function as a word-wise OR that reports a change
+            static bool joinInto(LivenessInfo* src, LivenessInfo* dst){
+                return dst->LivenessDefs.unionWith(src->LivenessDefs);
+            }
+    };
+    //define a subclass of DataFlowAnalysis: LivenessAnalysis
+    class LivenessAnalysis final: public DataFlowAnalysis<LivenessInfo,false,LivenessAnalysis> {
+        private:
+            //The solver calls flowfunction statically, see DataFlowAnalysis
+            friend class DataFlowAnalysis<LivenessInfo,false,LivenessAnalysis>;
+            //Implement flowfunction to process three types of instructions
+            void flowfunction(Instruction * I,std::vector<unsigned> & IncomingEdges,std::vector<unsigned> & OutgoingEdges,std::vector<LivenessInfo *> & InfoOut) override{
+                unsigned curNodeIndex=InstrToIndex[I];
+                // 1st type is instruction that define a variable in IR code, 2nd type is instruction that doesn't define variable, 3rd type is phi instruction (specifically all successive phi instructions are condiered as a whole node, which means this type of instruction will define many variables "at the same time")   
+                InstrKind instrType=classifyInstr(I);
+                //Join all infos on all incomingEdges
+                LivenessInfo AllInfoIn;
+                for(auto incomingNodeIndex: IncomingEdges){
+                    LivenessInfo* tmpInfo=getEdgeInfo(incomingNodeIndex,curNodeIndex);
+                    LivenessInfo::join(&AllInfoIn,tmpInfo,&AllInfoIn);
+                }
+                //if it's 1st or 2nd type instruction, then add the index of operands to the set of incoming information. For the 1st type instruction, remove the index of result from incoming information.
+                if(DefInstr==instrType||NonDefInstr==instrType){
+                    unsigned operandNum=I->getNumOperands();
+                    //Remove the index of current instruction if it defines a new variable
+                    if(DefInstr==instrType)
+                        AllInfoIn.LivenessDefs.reset(curNodeIndex);     //??erase may need to be moved to the front of insert. And we shouldn't modify the incoming info. Rather we should copy it to info out, then modify
+
+                    //Add indices of instructions where operands are defined 
+                    for(unsigned i=0;i<operandNum;++i){
+                        if(false==isa<Constant>(I->getOperand(i))){ 
+                            Instruction* OperandInstr=dyn_cast<Instruction>(I->getOperand(i));
+                            AllInfoIn.LivenessDefs.set(InstrToIndex[OperandInstr]);
+                        }
+                    }
+                    
+                    //put the output reachingInfo to the result container
+                    for(unsigned i=0;i<InfoOut.size();++i){
+                        InfoOut[i]->LivenessDefs=AllInfoIn.LivenessDefs;
+                    }
+                }else if(PhiInstr==instrType){         //if it's 3rd type instruction, join the set of all successive phi instructions with the set of incoming information
+                    BasicBlock * parentBlock=I->getParent();    //get the block that the first phi instruction belongs to
+                    unsigned nonPhiIndex=InstrToIndex[parentBlock->getFirstNonPHI()];       //get the index of the first Non-phi instruction
+                    for(unsigned i=curNodeIndex;i<nonPhiIndex;++i){    //remove all indices between them from the incoming information set, since they represent of definition of results they generate.
+                        AllInfoIn.LivenessDefs.reset(i);
+                    }
+                    for(unsigned i=0;i<InfoOut.size();++i){     //Iterate through all outgoing edges
+                        InfoOut[i]->LivenessDefs=AllInfoIn.LivenessDefs;    
+                        for(unsigned j=curNodeIndex;j<nonPhiIndex;++j){     //For each outgoing edge, iterate through phi nodes
+                            PHINode* curPhiNode=dyn_cast<PHINode>(IndexToInstr[j]);
+                            unsigned PhiOperandNum=curPhiNode->getNumIncomingValues();  //Get how many operands (value,block pairs) this phi node has
+                            for(unsigned k=0;k<PhiOperandNum;++k){      //Iterate through all pairs
+                                BasicBlock* operandBlock=curPhiNode->getIncomingBlock(k);   //Which block does this pair go
+                                if(operandBlock==IndexToInstr[OutgoingEdges[i]]->getParent()){  //The value will be added to the info set only when the block this pair goes equals to the block this outgoing edge go
+                                    Value* operandValue=curPhiNode->getIncomingValue(k);
+                                    Instruction* OperandInstr=dyn_cast<Instruction>(operandValue);  //Get the instruction where the value in the pair is defined
+                                    (InfoOut[i]->LivenessDefs).set(InstrToIndex[OperandInstr]);  //Add it to the info set.
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        public:
+            //the constructor which explicitly call the constructor of parent class
+            LivenessAnalysis(LivenessInfo& bottom, LivenessInfo& initialState):DataFlowAnalysis(bottom,initialState){}
+    };
+
+} // namespace llvm
+
+#endif
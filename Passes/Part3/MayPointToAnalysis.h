@@ -0,0 +1,281 @@
+//===- MayPointToAnalysis.h - May-point-to analysis -------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file provides the may-point-to analysis of CSE 231 part 3.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_231MAYPOINTTOANALYSIS_H
+#define LLVM_TRANSFORMS_231MAYPOINTTOANALYSIS_H
+
+#include "231DFA.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/ImmutableMap.h"
+#include "llvm/IR/Instructions.h"
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace llvm {
+
+    //A pointer of the analysis: ('R', index) for the value defined by an instruction, ('M', index) for the memory it allocates
+    typedef std::pair<char,unsigned> PtrID;
+
+    //Profile of PtrID as the key of an ImmutableMap
+    template<> struct ImutProfileInfo<PtrID>{
+        typedef const PtrID value_type;
+        typedef const PtrID& value_type_ref;
+        static void Profile(FoldingSetNodeID &ID, value_type_ref X){
+            ID.AddInteger(X.first);
+            ID.AddInteger(X.second);
+        }
+    };
+
+    //Hash-consing table of the points-to sets of one analysis. Every distinct set is stored once, as a sorted
+    //vector, and named by its id: equal sets have equal ids and unions are memoized per pair of ids.
+    //The table also owns the trees of the maps from pointers to ids of the facts.
+    class PointsToSetTable
+    {
+        public:
+            typedef unsigned SetID;
+            enum : SetID { EmptySet=0 };
+            typedef ImmutableMap<PtrID,SetID> PointsToMap;
+
+            PointsToMap::Factory MapFactory;
+
+            PointsToSetTable():MapFactory(false){
+                intern(std::vector<PtrID>());
+            }
+            PointsToSetTable(const PointsToSetTable &)=delete;
+            PointsToSetTable &operator=(const PointsToSetTable &)=delete;
+
+            const std::vector<PtrID>& getSet(SetID id) const{
+                return Sets[id];
+            }
+            unsigned getNumSets() const{
+                return Sets.size();
+            }
+            //Id of a sorted set without duplicates
+            SetID intern(std::vector<PtrID> set){
+                std::vector<SetID>& bucket=Buckets[hash_combine_range(set.begin(),set.end())];
+                for(SetID id:bucket){
+                    if(Sets[id]==set)
+                        return id;
+                }
+                bucket.push_back(Sets.size());
+                Sets.push_back(std::move(set));
+                return Sets.size()-1;
+            }
+            SetID getSingleton(PtrID p){
+                return intern(std::vector<PtrID>(1,p));
+            }
+            SetID unite(SetID a, SetID b){
+                if(a==b||b==EmptySet)
+                    return a;
+                if(a==EmptySet)
+                    return b;
+                if(a>b)
+                    std::swap(a,b);
+                auto it=UnionMemo.find(std::make_pair(a,b));
+                if(it!=UnionMemo.end())
+                    return it->second;
+                std::vector<PtrID> merged;
+                merged.reserve(Sets[a].size()+Sets[b].size());
+                std::set_union(Sets[a].begin(),Sets[a].end(),Sets[b].begin(),Sets[b].end(),std::back_inserter(merged));
+                SetID id=intern(std::move(merged));
+                UnionMemo[std::make_pair(a,b)]=id;
+                return id;
+            }
+        private:
+            std::vector<std::vector<PtrID>> Sets;
+            std::unordered_map<size_t,std::vector<SetID>> Buckets;
+            DenseMap<std::pair<SetID,SetID>,SetID> UnionMemo;
+    };
+
+    //define a subclass of Info: MayPointToInfo
+    class MayPointToInfo final: public Info
+    {
+        public:
+            //The table of the ids, shared by all the facts of one analysis, set whenever MayPointMap is not empty
+            std::shared_ptr<PointsToSetTable> Sets;
+            //The points-to set of each pointer, by id in Sets. Only pointers with a non-empty set are keys.
+            //Persistent map: a copy shares the tree, and an update copies only the path to its entry.
+            PointsToSetTable::PointsToMap MayPointMap;
+
+            MayPointToInfo():MayPointMap(nullptr){}
+            MayPointToInfo(const MayPointToInfo &other):Info(other),Sets(other.Sets),MayPointMap(other.MayPointMap){}
+            MayPointToInfo& operator=(const MayPointToInfo &other){
+                MayPointMap=other.MayPointMap;  //release the old tree while its table is alive
+                Sets=other.Sets;
+                return *this;
+            }
+            //The set of p, empty if p is not a key
+            PointsToSetTable::SetID get(PtrID p) const{
+                const PointsToSetTable::SetID* id=MayPointMap.lookup(p);
+                return id?*id:PointsToSetTable::EmptySet;
+            }
+            void set(PtrID p, PointsToSetTable::SetID id){
+                MayPointMap=Sets->MapFactory.add(MayPointMap,p,id);
+            }
+            //Implement virtual function of parent class to print reaching definition
+            void print(raw_ostream &OS) override{
+                for(auto iter:MayPointMap){
+                    OS<<iter.first.first<<iter.first.second<<"->(";
+                    for(auto iter2:Sets->getSet(iter.second)){
+                        OS<<iter2.first<<iter2.second<<'/';
+                    }
+                    OS<<")|";
+                }
+                OS<<"\n";
+            }
+            void write(cse231result::FunctionWriter &W) override{
+                std::vector<std::pair<PtrID, std::vector<PtrID>>> map;
+                for(auto& iter:MayPointMap)
+                    map.emplace_back(iter.first,Sets->getSet(iter.second));
+                W.writePointsTo(map);
+            }
+            //Number of points-to pairs
+            unsigned size() override{
+                unsigned n=0;
+                for(auto& iter:MayPointMap)
+                    n+=Sets->getSet(iter.second).size();
+                return n;
+            }
+            //Implement equal function, the sets are compared by id and subtrees shared by both maps are skipped
+            static bool equals(MayPointToInfo* info1, MayPointToInfo* info2){
+                return info1->MayPointMap==info2->MayPointMap;
+            }
+            //Implement join() function, the sets of a pointer in both infos are united through the table.
+            //The entries of info1 are added to the tree of info2, so joining a fact into an edge that already
+            //holds it returns the tree of the edge and equals() is a pointer compare.
+            static MayPointToInfo* join(MayPointToInfo* info1, MayPointToInfo* info2, MayPointToInfo* result){
+                typedef PointsToSetTable::PointsToMap::TreeTy TreeTy;
+                std::shared_ptr<PointsToSetTable> sets=info1->Sets?info1->Sets:info2->Sets;
+                PointsToSetTable::PointsToMap joined=info2->MayPointMap;
+                //walk both trees in the order of the pointers, skipping the subtrees they share
+                TreeTy::iterator iter1(info1->MayPointMap.getRootWithoutRetain()),iter2(info2->MayPointMap.getRootWithoutRetain()),end;
+                while(iter1!=end){
+                    if(iter2!=end && &*iter1==&*iter2){
+                        iter1.skipSubTree();
+                        iter2.skipSubTree();
+                        continue;
+                    }
+                    PtrID key=iter1->getValue().first;
+                    PointsToSetTable::SetID id1=iter1->getValue().second;
+                    if(iter2!=end && iter2->getValue().first<key){
+                        ++iter2;
+                        continue;
+                    }
+                    if(iter2==end || key<iter2->getValue().first){  //only info1 has this pointer
+                        joined=sets->MapFactory.add(joined,key,id1);
+                    }else{
+                        PointsToSetTable::SetID id2=iter2->getValue().second;
+                        if(id1!=id2)
+                            joined=sets->MapFactory.add(joined,key,sets->unite(id2,id1));
+                        ++iter2;
+                    }
+                    ++iter1;
+                }
+                result->MayPointMap=joined;
+                result->Sets=sets;
+                return result;
+            }
+            //Implement joinInto() function, dst keeps its tree unless an entry of src adds to it
+            static bool joinInto(MayPointToInfo* src, MayPointToInfo* dst){
+                PointsToSetTable::PointsToMap old=dst->MayPointMap;
+                join(src,dst,dst);
+                return dst->MayPointMap.getRootWithoutRetain()!=old.getRootWithoutRetain();
+            }
+    };
+    //define a subclass of DataFlowAnalysis: MayPointToDefinitionAnalysis
+    class MayPointToDefinitionAnalysis final: public DataFlowAnalysis<MayPointToInfo,true,MayPointToDefinitionAnalysis> {
+        private:
+            //The solver calls flowfunction statically, see DataFlowAnalysis
+            friend class DataFlowAnalysis<MayPointToInfo,true,MayPointToDefinitionAnalysis>;
+            //The points-to sets of the facts of this analysis
+            std::shared_ptr<PointsToSetTable> Sets;
+            //Implement flowfunction to process three types of instructions
+            void flowfunction(Instruction * I,std::vector<unsigned> & IncomingEdges,std::vector<unsigned> & OutgoingEdges,std::vector<MayPointToInfo *> & InfoOut) override{
+                unsigned curNodeIndex=InstrToIndex[I];
+                unsigned opcode=I->getOpcode();
+
+                //Join all infos on all incomingEdges
+                MayPointToInfo AllInfoIn;
+                for(auto edgeIndex: IncomingEdges){
+                    MayPointToInfo* tmpInfo=getEdgeInfo(edgeIndex,curNodeIndex);
+                    MayPointToInfo::join(&AllInfoIn,tmpInfo,&AllInfoIn);
+                }
+
+                AllInfoIn.Sets=Sets;
+                if(opcode==Instruction::Alloca){
+                    addPointsTo(AllInfoIn,PtrID('R',curNodeIndex),Sets->getSingleton(PtrID('M',curNodeIndex)));
+                }else if(opcode==Instruction::BitCast||opcode==Instruction::GetElementPtr){
+                    Instruction* srcInstr;
+                    if(opcode==Instruction::BitCast)
+                        srcInstr=dyn_cast<Instruction>(I->getOperand(0));
+                    else
+                        srcInstr=dyn_cast<Instruction>((dyn_cast<GetElementPtrInst>(I))->getPointerOperand());
+                    addPointsTo(AllInfoIn,PtrID('R',curNodeIndex),AllInfoIn.get(PtrID('R',InstrToIndex[srcInstr])));
+                }else if(opcode==Instruction::Load){
+                    Instruction* srcInstr=dyn_cast<Instruction>((dyn_cast<LoadInst>(I))->getPointerOperand());
+                    PointsToSetTable::SetID srcSet=AllInfoIn.get(PtrID('R',InstrToIndex[srcInstr]));
+                    for(auto iter:Sets->getSet(srcSet)){
+                        addPointsTo(AllInfoIn,PtrID('R',curNodeIndex),AllInfoIn.get(iter));
+                    }
+                }else if(opcode==Instruction::Store){
+                    Instruction* srcInstr=dyn_cast<Instruction>((dyn_cast<StoreInst>(I))->getValueOperand());
+                    PointsToSetTable::SetID srcSet=AllInfoIn.get(PtrID('R',InstrToIndex[srcInstr]));
+                    Instruction* dstInstr=dyn_cast<Instruction>((dyn_cast<StoreInst>(I))->getPointerOperand());
+                    PointsToSetTable::SetID dstSet=AllInfoIn.get(PtrID('R',InstrToIndex[dstInstr]));
+                    for(auto iter1:Sets->getSet(dstSet)){
+                        addPointsTo(AllInfoIn,iter1,srcSet);
+                    }
+                }else if(opcode==Instruction::Select){
+                    Instruction* srcInstr1=dyn_cast<Instruction>((dyn_cast<SelectInst>(I))->getTrueValue());
+                    addPointsTo(AllInfoIn,PtrID('R',curNodeIndex),AllInfoIn.get(PtrID('R',InstrToIndex[srcInstr1])));
+                    Instruction* srcInstr2=dyn_cast<Instruction>((dyn_cast<SelectInst>(I))->getFalseValue());
+                    addPointsTo(AllInfoIn,PtrID('R',curNodeIndex),AllInfoIn.get(PtrID('R',InstrToIndex[srcInstr2])));
+                }else if(opcode==Instruction::PHI){
+                    BasicBlock * parentBlock=I->getParent();    //get the block that the first phi instruction belongs to
+                    unsigned nonPhiIndex=InstrToIndex[parentBlock->getFirstNonPHI()];       //get the index of the first Non-phi instruction
+
+                    for(unsigned j=curNodeIndex;j<nonPhiIndex;++j){     //Iterate through phi nodes
+                        PHINode* curPhiNode=dyn_cast<PHINode>(IndexToInstr[j]);
+                        unsigned PhiOperandNum=curPhiNode->getNumIncomingValues();  //Get how many operands (<value,block> pairs) this phi node has
+                        for(unsigned k=0;k<PhiOperandNum;++k){      //Iterate through all pairs
+                            Value* operandValue=curPhiNode->getIncomingValue(k);
+                            Instruction* OperandInstr=dyn_cast<Instruction>(operandValue);  //Get the instruction where the value in the pair is defined
+                            addPointsTo(AllInfoIn,PtrID('R',curNodeIndex),AllInfoIn.get(PtrID('R',InstrToIndex[OperandInstr])));
+                        }
+                    }
+                }
+                for(unsigned i=0;i<InfoOut.size();++i){
+                    *InfoOut[i]=AllInfoIn;
+                }
+            }
+            //Add the pointers of set to the set of p in info
+            void addPointsTo(MayPointToInfo& info,PtrID p,PointsToSetTable::SetID set){
+                if(set==PointsToSetTable::EmptySet)
+                    return;
+                PointsToSetTable::SetID cur=info.get(p);
+                PointsToSetTable::SetID united=Sets->unite(cur,set);
+                if(united!=cur)
+                    info.set(p,united);
+            }
+        public:
+            //the constructor which explicitly call the constructor of parent class
+            MayPointToDefinitionAnalysis(MayPointToInfo& bottom, MayPointToInfo& initialState):DataFlowAnalysis(bottom,initialState),Sets(std::make_shared<PointsToSetTable>()){}
+    };
+
+} // namespace llvm
+
+#endif
@@ -0,0 +1,28 @@
+#include "SSALiveness.h"
+#include "llvm/Pass.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+namespace{
+    struct SSALivenessPass:public ModulePass {
+        static char ID;
+        SSALivenessPass() : ModulePass(ID) {}
+
+        bool runOnModule(Module &M) override {
+            //Analyze the functions in parallel, the results are printed in module order
+            runOnFunctionsInParallel(M,[](Function &F,raw_ostream &OS){
+                SSALiveness Liveness;
+                Liveness.compute(&F);   //Walk the uses up to their definitions, no worklist iteration
+                Liveness.print(OS);     //Print the same edges as -cse231-liveness into the buffer of this function
+            },errs(),"ssa-liveness");
+
+            return false;
+        }
+    };
+}
+
+char SSALivenessPass::ID = 0;
+static RegisterPass<SSALivenessPass> X("cse231-ssa-liveness", "Liveness of variables from the def-use chains of SSA form", false /* Only looks at CFG */, false /* Analysis Pass */);
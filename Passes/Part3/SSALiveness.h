@@ -0,0 +1,254 @@
+//===- SSALiveness.h - Liveness from def-use chains -----------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file provides a liveness engine for SSA form that computes the same
+// result as the liveness analysis of CSE 231 part 3 without iterating a
+// dataflow problem: every use is walked up the CFG to the definition of the
+// value it uses (path exploration), marking the blocks the value is live in.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_231SSALIVENESS_H
+#define LLVM_TRANSFORMS_231SSALIVENESS_H
+
+#include "231DFA.h"
+#include "LivenessAnalysis.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/TimeProfiler.h"
+#include <vector>
+
+namespace llvm {
+
+/*
+ * Values are named by the instruction indices of assignIndiceToInstrs, like
+ * the facts of LivenessAnalysis, with its conventions: index 0 stands for
+ * every operand that is neither an instruction nor a constant (arguments,
+ * labels) and for the constant incoming values of phis, and only the values
+ * of def and phi instructions (see classifyInstr) are killed at their
+ * definition; the others are live up to the entry of the function from any use.
+ *
+ * Only the live-in and live-out sets of basic blocks are stored, so a query is
+ * a bit test, and the live set of every edge is rebuilt a block at a time by
+ * print().
+ */
+class SSALiveness {
+  public:
+    SSALiveness() : Func(nullptr) {}
+    SSALiveness(const SSALiveness &) = delete;
+    SSALiveness &operator=(const SSALiveness &) = delete;
+
+    /*
+     * Compute the live-in and live-out sets of the blocks of F. Any previous
+     * result is dropped.
+     */
+    void compute(Function *F) {
+      TimeTraceScope traceScope("CSE231SSALiveness");
+      Func = F;
+      IndexToInstr.assign(1, nullptr);
+      InstrToIndex.clear();
+      Blocks.clear();
+      BlockToIndex.clear();
+      DefBlock.assign(1, NoDefBlock);
+
+      for (BasicBlock &block : *F) {
+        BlockToIndex[&block] = Blocks.size();
+        Blocks.push_back(&block);
+      }
+      for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+        Instruction *instr = &*I;
+        InstrToIndex[instr] = IndexToInstr.size();
+        IndexToInstr.push_back(instr);
+        DefBlock.push_back(classifyInstr(instr) == NonDefInstr ? NoDefBlock : BlockToIndex[instr->getParent()]);
+      }
+      LiveIn.assign(Blocks.size(), FactBitVector());
+      LiveOut.assign(Blocks.size(), FactBitVector());
+
+      for (unsigned blockId = 0; blockId < Blocks.size(); ++blockId) {
+        for (Instruction &instr : *Blocks[blockId]) {
+          if (PHINode *phi = dyn_cast<PHINode>(&instr)) {
+            //an incoming value is used at the end of its incoming block
+            for (unsigned k = 0; k < phi->getNumIncomingValues(); ++k)
+              markLiveOut(getValueIndex(phi->getIncomingValue(k)), BlockToIndex[phi->getIncomingBlock(k)]);
+            continue;
+          }
+          unsigned useIndex = InstrToIndex[&instr];
+          for (Value *operand : instr.operands()) {
+            if (isa<Constant>(operand))
+              continue;
+            unsigned index = getValueIndex(operand);
+            //a use below the definition in the same block is not live at the top of the block
+            if (DefBlock[index] == blockId && (isa<PHINode>(IndexToInstr[index]) || index < useIndex))
+              continue;
+            markLiveIn(index, blockId);
+          }
+        }
+      }
+    }
+
+    /*
+     * Whether V is live at the top of B (below its phis) or at the end of B.
+     * Constants are never live.
+     */
+    bool isLiveIn(const Value *V, const BasicBlock *B) const {
+      auto it = BlockToIndex.find(B);
+      return !isa<Constant>(V) && it != BlockToIndex.end() && LiveIn[it->second].test(getValueIndex(V));
+    }
+
+    bool isLiveOut(const Value *V, const BasicBlock *B) const {
+      auto it = BlockToIndex.find(B);
+      return !isa<Constant>(V) && it != BlockToIndex.end() && LiveOut[it->second].test(getValueIndex(V));
+    }
+
+    const FactBitVector &getLiveIn(const BasicBlock *B) const { return LiveIn[BlockToIndex.lookup(B)]; }
+
+    const FactBitVector &getLiveOut(const BasicBlock *B) const { return LiveOut[BlockToIndex.lookup(B)]; }
+
+    /*
+     * Print the live set of every edge of LivenessAnalysis, as its print() does.
+     */
+    void print(raw_ostream &OS) {
+      TimeTraceScope traceScope("CSE231Print");
+      bool binary = DFAOutputFormat == DFABinaryOutput;
+      cse231result::FunctionWriter W(Func->getName());
+      //the edges ordered by (source, destination): the sources of the edges are
+      //the instructions in index order, and the edge from the dummy node comes first
+      LivenessInfo empty;
+      printEdge(OS, W, 0, InstrToIndex[Func->back().getTerminator()], empty);
+
+      std::vector<LivenessInfo> liveBefore;
+      std::vector<unsigned> predTerms;
+      for (unsigned blockId = 0; blockId < Blocks.size(); ++blockId) {
+        BasicBlock *block = Blocks[blockId];
+        Instruction *firstNonPhi = block->getFirstNonPHI();
+        unsigned firstIndex = InstrToIndex[&block->front()];
+        unsigned nonPhiIndex = InstrToIndex[firstNonPhi];
+
+        //the live sets above the non-phi instructions, from the bottom of the block up
+        unsigned numNonPhis = InstrToIndex[block->getTerminator()] - nonPhiIndex + 1;
+        liveBefore.resize(numNonPhis);
+        LivenessInfo live;
+        live.LivenessDefs = LiveOut[blockId];
+        for (unsigned i = numNonPhis; i-- > 0;) {
+          Instruction *instr = IndexToInstr[nonPhiIndex + i];
+          if (classifyInstr(instr) == DefInstr)
+            live.LivenessDefs.reset(nonPhiIndex + i);
+          for (Value *operand : instr->operands()) {
+            if (false == isa<Constant>(operand))
+              live.LivenessDefs.set(getValueIndex(operand));
+          }
+          liveBefore[i] = live;
+        }
+
+        predTerms.clear();
+        for (BasicBlock *pred : predecessors(block))
+          predTerms.push_back(InstrToIndex[pred->getTerminator()]);
+        llvm::sort(predTerms);
+        predTerms.erase(std::unique(predTerms.begin(), predTerms.end()), predTerms.end());
+
+        if (isa<PHINode>(&block->front())) {
+          //the phis of the block are killed, and each incoming edge adds its own incoming values
+          for (unsigned index = firstIndex; index < nonPhiIndex; ++index)
+            live.LivenessDefs.reset(index);
+          for (unsigned term : predTerms) {
+            LivenessInfo edgeLive = live;
+            BasicBlock *pred = IndexToInstr[term]->getParent();
+            for (unsigned index = firstIndex; index < nonPhiIndex; ++index) {
+              PHINode *phi = cast<PHINode>(IndexToInstr[index]);
+              for (unsigned k = 0; k < phi->getNumIncomingValues(); ++k) {
+                if (phi->getIncomingBlock(k) == pred)
+                  edgeLive.LivenessDefs.set(getValueIndex(phi->getIncomingValue(k)));
+              }
+            }
+            printEdge(OS, W, firstIndex, term, edgeLive);
+          }
+          printEdge(OS, W, nonPhiIndex, firstIndex, liveBefore[0]);
+        } else {
+          for (unsigned term : predTerms)
+            printEdge(OS, W, nonPhiIndex, term, liveBefore[0]);
+        }
+        for (unsigned i = 1; i < numNonPhis; ++i)
+          printEdge(OS, W, nonPhiIndex + i, nonPhiIndex + i - 1, liveBefore[i]);
+      }
+
+      if (binary)
+        OS << W.finish();
+    }
+
+  private:
+    enum : unsigned { NoDefBlock = ~0u };
+
+    /*
+     * The index naming V: its instruction index, or 0 for anything else.
+     */
+    unsigned getValueIndex(const Value *V) const {
+      const Instruction *instr = dyn_cast<Instruction>(V);
+      return instr ? InstrToIndex.lookup(instr) : 0;
+    }
+
+    /*
+     * The value index is live at the end of block: mark it there and in every
+     * block above that a path reaches without crossing its definition.
+     */
+    void markLiveOut(unsigned index, unsigned blockId) {
+      if (LiveOut[blockId].test(index))
+        return;
+      LiveOut[blockId].set(index);
+      if (DefBlock[index] != blockId)
+        markLiveIn(index, blockId);
+    }
+
+    void markLiveIn(unsigned index, unsigned blockId) {
+      std::vector<unsigned> stack(1, blockId);
+      while (!stack.empty()) {
+        unsigned block = stack.back();
+        stack.pop_back();
+        if (LiveIn[block].test(index))
+          continue;
+        LiveIn[block].set(index);
+        for (BasicBlock *pred : predecessors(Blocks[block])) {
+          unsigned predId = BlockToIndex[pred];
+          if (LiveOut[predId].test(index))
+            continue;
+          LiveOut[predId].set(index);
+          if (DefBlock[index] != predId)
+            stack.push_back(predId);
+        }
+      }
+    }
+
+    void printEdge(raw_ostream &OS, cse231result::FunctionWriter &W, unsigned src, unsigned dst, LivenessInfo &info) {
+      if (DFAOutputFormat == DFABinaryOutput) {
+        W.beginEdge(src, dst);
+        info.write(W);
+        return;
+      }
+      OS << "Edge " << src << "->" "Edge " << dst << ":";
+      info.print(OS);
+    }
+
+    Function *Func;
+    // Index to instruction map, index 0 is the dummy node
+    std::vector<Instruction *> IndexToInstr;
+    DenseMap<const Instruction *, unsigned> InstrToIndex;
+    std::vector<BasicBlock *> Blocks;
+    DenseMap<const BasicBlock *, unsigned> BlockToIndex;
+    // Block id of the definition that kills each value index, NoDefBlock if nothing does
+    std::vector<unsigned> DefBlock;
+    // Live values at the top of each block (below its phis) and at its end
+    std::vector<FactBitVector> LiveIn;
+    std::vector<FactBitVector> LiveOut;
+};
+
+} // namespace llvm
+
+#endif
@@ -0,0 +1,485 @@
+//===- 231DFA.cpp - Module level driver of the CSE 231 dataflow framework -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the module level parts of the CSE 231 dataflow
+// framework declared in 231DFA.h: the shared command line options, the
+// driver running functions on a thread pool in module or call graph order,
+// the on-disk result cache, the solver statistics and the output stream.
+//
+//===----------------------------------------------------------------------===//
+
+#include "231DFA.h"
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/CallGraph.h"
+#include "llvm/IR/ModuleSlotTracker.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/TimeProfiler.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+
+#define DEBUG_TYPE "cse231-dfa"
+
+STATISTIC(NumSolverJoins, "Number of joins in the worklist algorithm");
+STATISTIC(NumSolverEqualityChecks, "Number of equality checks in the worklist algorithm");
+STATISTIC(NumSolverRequeues, "Number of worklist items queued again");
+STATISTIC(NumSolverFactUpdates, "Number of edge information updates");
+STATISTIC(MaxSolverFactSize, "Largest information of an edge");
+STATISTIC(NumSolverInfoBytes, "Bytes of Info objects allocated by the worklist algorithm");
+
+namespace llvm {
+
+// Registering an option name twice aborts the tool, and opt may load several
+// libraries built from this file (submission_pt2.so and submission_pt3.so, or
+// submission_pt4.so and CSE231Passes.so). The options are created by the first
+// library loaded, which stays loaded, and looked up by name in the others.
+template <typename OptTy, typename... Mods>
+static OptTy &getSharedOption(StringRef Name, const Mods &... Ms) {
+  StringMap<cl::Option *> &Options = cl::getRegisteredOptions();
+  auto It = Options.find(Name);
+  if (It != Options.end())
+    return *static_cast<OptTy *>(It->second);
+  return *new OptTy(Name, Ms...);
+}
+
+cl::opt<bool> &DFABlockGranularity = getSharedOption<cl::opt<bool>>("cse231-block-dfa", cl::init(false),
+    cl::desc("Solve the cse231 dataflow analyses at basic block granularity"));
+
+cl::opt<unsigned> &DFAThreads = getSharedOption<cl::opt<unsigned>>("cse231-threads", cl::init(0u),
+    cl::desc("Number of threads analyzing functions in parallel (0 = one per hardware thread)"));
+
+cl::opt<std::string> &DFACacheDir = getSharedOption<cl::opt<std::string>>("cse231-cache-dir", cl::init(std::string()),
+    cl::desc("Directory caching the per-function output of the cse231 analyses across runs"));
+
+cl::opt<DFAOutputFormatKind> &DFAOutputFormat = getSharedOption<cl::opt<DFAOutputFormatKind>>(
+    "cse231-output-format", cl::init(DFATextOutput),
+    cl::desc("Format of the results of the cse231 analyses"),
+    cl::values(clEnumValN(DFATextOutput, "text", "One line per edge (default)"),
+               clEnumValN(DFABinaryOutput, "binary", "Compact binary records, read with cse231-result")));
+
+cl::opt<std::string> &DFAOutputFile = getSharedOption<cl::opt<std::string>>("cse231-output", cl::init(std::string()),
+    cl::desc("File receiving the results of the cse231 analyses instead of stderr"));
+
+cl::opt<std::string> &DFAStatsDir = getSharedOption<cl::opt<std::string>>("cse231-stats-dir", cl::init(std::string()),
+    cl::desc("Directory receiving the solver statistics of each function as JSON "
+             "(builds with CSE231_DFA_STATS only)"));
+
+namespace {
+
+// Bump when the output of an analysis changes, so stale entries are missed
+const char *const CacheVersion = "cse231-cache-1";
+
+// The output of one function, as a file in the cache directory named by the
+// hex MD5 of its key. Files are written under a temporary name and renamed,
+// so concurrent runs sharing the directory never see a partial entry.
+class ResultCache {
+public:
+  ResultCache(StringRef Dir) : Dir(Dir) {}
+
+  bool lookup(const MD5::MD5Result &Key, raw_ostream &OS) const {
+    // Large entries are memory mapped rather than read
+    ErrorOr<std::unique_ptr<MemoryBuffer>> Buffer =
+        MemoryBuffer::getFile(getPath(Key), /*IsText=*/false, /*RequiresNullTerminator=*/false);
+    if (!Buffer)
+      return false;
+    OS << (*Buffer)->getBuffer();
+    return true;
+  }
+
+  void store(const MD5::MD5Result &Key, StringRef Output) const {
+    SmallString<128> Path = getPath(Key);
+    SmallString<128> TempPath;
+    int FD;
+    if (sys::fs::createUniqueFile(Path + ".tmp%%%%%%", FD, TempPath))
+      return;
+    {
+      raw_fd_ostream Out(FD, /*shouldClose=*/true);
+      Out << Output;
+      if (Out.has_error()) {
+        Out.clear_error();
+        sys::fs::remove(TempPath);
+        return;
+      }
+    }
+    if (sys::fs::rename(TempPath, Path))
+      sys::fs::remove(TempPath);
+  }
+
+private:
+  SmallString<128> getPath(const MD5::MD5Result &Key) const {
+    SmallString<128> Path(Dir);
+    sys::path::append(Path, Key.digest());
+    return Path;
+  }
+
+  std::string Dir;
+};
+
+} // namespace
+
+// The -time-trace-granularity of the tool, which owns the option, for the
+// profilers of the worker threads
+static unsigned getTimeTraceGranularity() {
+  StringMap<cl::Option *> &Options = cl::getRegisteredOptions();
+  auto It = Options.find("time-trace-granularity");
+  if (It == Options.end())
+    return 500;
+  return *static_cast<cl::opt<unsigned> *>(It->second);
+}
+
+namespace {
+
+// Runs Body on the functions with a body of a module, by index in module
+// order, or takes their output from the cache
+class FunctionRunner {
+public:
+  FunctionRunner(Module &M, function_ref<void(Function &, raw_ostream &)> Body, StringRef CacheTag,
+                 function_ref<void(Function &, MD5 &)> CacheKey)
+      : Body(Body), CacheKey(CacheKey), Cache(DFACacheDir) {
+    for (Function &F : M) {
+      if (!F.isDeclaration())
+        Funcs.push_back(&F);
+    }
+
+    // The IR is hashed up front: printing it is not safe to do while other
+    // threads are printing, and one slot tracker serves all functions of the
+    // module. CacheKey is left to run(), as what it hashes may not be final yet.
+    UseCache = !DFACacheDir.empty() && !CacheTag.empty() && !sys::fs::create_directories(DFACacheDir);
+    if (!UseCache)
+      return;
+    ModuleSlotTracker MST(&M);
+    std::string IR;
+    for (Function *F : Funcs) {
+      IR.clear();
+      raw_string_ostream IROS(IR);
+      static_cast<Value *>(F)->print(IROS, MST); // Function::print has no slot tracker overload
+      IROS.flush();
+      Hashes.emplace_back();
+      MD5 &Hash = Hashes.back();
+      Hash.update(CacheVersion);
+      Hash.update(CacheTag);
+      Hash.update(DFABlockGranularity ? "block" : "node");
+      Hash.update(DFAOutputFormat == DFABinaryOutput ? "binary" : "text");
+      Hash.update(IR);
+    }
+  }
+
+  unsigned size() const { return Funcs.size(); }
+
+  Function &getFunction(unsigned I) const { return *Funcs[I]; }
+
+  void run(unsigned I, raw_ostream &Out) const {
+    TimeTraceScope Scope("CSE231Function", Funcs[I]->getName());
+    if (!UseCache) {
+      Body(*Funcs[I], Out);
+      return;
+    }
+    MD5 Hash = Hashes[I];
+    if (CacheKey)
+      CacheKey(*Funcs[I], Hash);
+    MD5::MD5Result Key;
+    Hash.final(Key);
+    if (Cache.lookup(Key, Out))
+      return;
+    std::string Result;
+    raw_string_ostream ResultOS(Result);
+    Body(*Funcs[I], ResultOS);
+    ResultOS.flush();
+    Cache.store(Key, Result);
+    Out << Result;
+  }
+
+private:
+  function_ref<void(Function &, raw_ostream &)> Body;
+  function_ref<void(Function &, MD5 &)> CacheKey;
+  std::vector<Function *> Funcs;
+  bool UseCache;
+  std::vector<MD5> Hashes;
+  ResultCache Cache;
+};
+
+} // namespace
+
+// Run Work on NumThreads threads of a pool and wait for them. The profiler
+// is per thread; the ones of the workers are merged into the trace of the
+// main thread when they finish.
+static void runWorkers(ThreadPoolStrategy Strategy, unsigned NumThreads, function_ref<void()> Work) {
+  bool Tracing = timeTraceProfilerEnabled();
+  unsigned Granularity = Tracing ? getTimeTraceGranularity() : 0;
+  ThreadPool Pool(Strategy);
+  for (unsigned T = 0; T < NumThreads; ++T) {
+    Pool.async([&]() {
+      if (Tracing)
+        timeTraceProfilerInitialize(Granularity, "opt");
+      Work();
+      if (Tracing)
+        timeTraceProfilerFinishThread();
+    });
+  }
+  Pool.wait();
+}
+
+static void runOnFunctions(Module &M, function_ref<void(Function &, raw_ostream &)> Body, raw_ostream &OS,
+                           StringRef CacheTag, function_ref<void(Function &, MD5 &)> CacheKey) {
+  FunctionRunner Runner(M, Body, CacheTag, CacheKey);
+  ThreadPoolStrategy Strategy = hardware_concurrency(DFAThreads);
+  unsigned NumThreads = std::min<unsigned>(Strategy.compute_thread_count(), Runner.size());
+  if (NumThreads <= 1) {
+    for (unsigned I = 0; I < Runner.size(); ++I)
+      Runner.run(I, OS);
+    return;
+  }
+
+  std::vector<std::string> Outputs(Runner.size());
+  std::atomic<unsigned> Next(0);
+  runWorkers(Strategy, NumThreads, [&]() {
+    for (unsigned I = Next++; I < Runner.size(); I = Next++) {
+      raw_string_ostream Out(Outputs[I]);
+      Runner.run(I, Out);
+      Out.flush();
+    }
+  });
+
+  for (const std::string &Out : Outputs)
+    OS << Out;
+}
+
+static void runOnCallGraph(Module &M, CallGraph &CG, function_ref<void(ArrayRef<CallGraphNode *>)> SCCBody,
+                           function_ref<void(Function &, raw_ostream &)> Body, raw_ostream &OS,
+                           StringRef CacheTag, function_ref<void(Function &, MD5 &)> CacheKey) {
+  FunctionRunner Runner(M, Body, CacheTag, CacheKey);
+
+  // The condensation of the call graph, bottom-up, as CallGraphSCCPass
+  // visits it: only the nodes reachable from the external calling node
+  std::vector<std::vector<CallGraphNode *>> SCCs;
+  DenseMap<const CallGraphNode *, unsigned> SCCOf;
+  SmallVector<unsigned, 2> OutsideSCCs;     // the SCCs of the nodes of no function
+  for (scc_iterator<CallGraph *> I = scc_begin(&CG); !I.isAtEnd(); ++I) {
+    for (CallGraphNode *Node : *I) {
+      SCCOf[Node] = SCCs.size();
+      if (!Node->getFunction())
+        OutsideSCCs.push_back(SCCs.size());
+    }
+    SCCs.push_back(*I);
+  }
+
+  ThreadPoolStrategy Strategy = hardware_concurrency(DFAThreads);
+  unsigned NumThreads = std::min<unsigned>(Strategy.compute_thread_count(), SCCs.size() + Runner.size());
+  if (NumThreads <= 1) {
+    for (std::vector<CallGraphNode *> &SCC : SCCs)
+      SCCBody(SCC);
+    for (unsigned I = 0; I < Runner.size(); ++I)
+      Runner.run(I, OS);
+    return;
+  }
+
+  // Tasks 0 to SCCs.size()-1 run SCCBody, the next ones run Body on the
+  // functions. A task is ready when the count of the tasks it waits for
+  // drops to zero, and then it is queued.
+  unsigned NumSCCs = SCCs.size(), NumTasks = NumSCCs + Runner.size();
+  std::vector<unsigned> Pending(NumTasks);
+  std::vector<SmallVector<unsigned, 4>> Dependents(NumTasks);
+  auto setDependencies = [&](unsigned Task, SmallVectorImpl<unsigned> &Deps) {
+    llvm::sort(Deps);
+    Deps.erase(std::unique(Deps.begin(), Deps.end()), Deps.end());
+    for (unsigned Dep : Deps)
+      Dependents[Dep].push_back(Task);
+    Pending[Task] = Deps.size();
+  };
+  SmallVector<unsigned, 8> Deps;
+  for (unsigned S = 0; S < NumSCCs; ++S) {
+    Deps.clear();
+    for (CallGraphNode *Node : SCCs[S]) {
+      for (auto &Record : *Node) {
+        auto It = SCCOf.find(Record.second);
+        if (It != SCCOf.end() && It->second != S)
+          Deps.push_back(It->second);
+      }
+    }
+    setDependencies(S, Deps);
+  }
+  for (unsigned I = 0; I < Runner.size(); ++I) {
+    Deps.clear();
+    for (auto &Record : *CG[&Runner.getFunction(I)]) {
+      // The code outside the module is summarized once the external calling
+      // node, which comes last, is done
+      if (!Record.second->getFunction()) {
+        Deps.append(OutsideSCCs.begin(), OutsideSCCs.end());
+        continue;
+      }
+      auto It = SCCOf.find(Record.second);
+      if (It != SCCOf.end())
+        Deps.push_back(It->second);
+    }
+    setDependencies(NumSCCs + I, Deps);
+  }
+
+  // The SCCs are taken first, they are on the critical path
+  std::mutex QueueMutex;
+  std::condition_variable QueueReady;
+  std::deque<unsigned> ReadySCCs, ReadyFuncs;
+  unsigned Remaining = NumTasks;
+  for (unsigned Task = 0; Task < NumTasks; ++Task) {
+    if (!Pending[Task])
+      (Task < NumSCCs ? ReadySCCs : ReadyFuncs).push_back(Task);
+  }
+
+  std::vector<std::string> Outputs(Runner.size());
+  runWorkers(Strategy, NumThreads, [&]() {
+    std::unique_lock<std::mutex> Lock(QueueMutex);
+    while (true) {
+      QueueReady.wait(Lock, [&]() { return Remaining == 0 || !ReadySCCs.empty() || !ReadyFuncs.empty(); });
+      if (Remaining == 0)
+        return;
+      std::deque<unsigned> &Queue = ReadySCCs.empty() ? ReadyFuncs : ReadySCCs;
+      unsigned Task = Queue.front();
+      Queue.pop_front();
+      Lock.unlock();
+      if (Task < NumSCCs) {
+        SCCBody(SCCs[Task]);
+      } else {
+        raw_string_ostream Out(Outputs[Task - NumSCCs]);
+        Runner.run(Task - NumSCCs, Out);
+        Out.flush();
+      }
+      Lock.lock();
+      for (unsigned Dependent : Dependents[Task]) {
+        if (--Pending[Dependent] == 0)
+          (Dependent < NumSCCs ? ReadySCCs : ReadyFuncs).push_back(Dependent);
+      }
+      --Remaining;
+      QueueReady.notify_all();
+    }
+  });
+
+  for (const std::string &Out : Outputs)
+    OS << Out;
+}
+
+// Number of the most visited nodes listed in the JSON statistics
+static const unsigned NumHotNodes = 10;
+
+static void writeSolverStats(raw_ostream &OS, StringRef Analysis, const Function &F,
+                             const DFASolverStats &Stats) {
+  // Nodes by decreasing visits, and how many nodes were visited how often
+  std::vector<unsigned> Nodes;
+  std::map<unsigned, unsigned> Histogram;
+  for (unsigned Node = 0; Node < Stats.VisitsPerNode.size(); ++Node) {
+    if (!Stats.VisitsPerNode[Node])
+      continue;
+    Nodes.push_back(Node);
+    Histogram[Stats.VisitsPerNode[Node]]++;
+  }
+  llvm::stable_sort(Nodes, [&Stats](unsigned A, unsigned B) {
+    return Stats.VisitsPerNode[A] > Stats.VisitsPerNode[B];
+  });
+  Nodes.resize(std::min<size_t>(Nodes.size(), NumHotNodes));
+
+  json::OStream J(OS);
+  J.object([&] {
+    J.attribute("analysis", Analysis);
+    J.attribute("function", F.getName());
+    J.attribute("granularity", DFABlockGranularity ? "block" : "node");
+    J.attribute("node_visits", int64_t(Stats.NodeVisits));
+    J.attribute("flow_function_calls", int64_t(Stats.FlowFunctionCalls));
+    J.attribute("joins", int64_t(Stats.Joins));
+    J.attribute("equality_checks", int64_t(Stats.EqualityChecks));
+    J.attribute("requeues", int64_t(Stats.Requeues));
+    J.attribute("fact_updates", int64_t(Stats.FactUpdates));
+    J.attribute("max_fact_size", int64_t(Stats.MaxFactSize));
+    J.attribute("mean_fact_size", Stats.getMeanFactSize());
+    J.attribute("info_bytes", int64_t(Stats.InfoBytes));
+    J.attributeArray("visit_histogram", [&] {
+      for (auto &Bucket : Histogram)
+        J.array([&] {
+          J.value(int64_t(Bucket.first));
+          J.value(int64_t(Bucket.second));
+        });
+    });
+    J.attributeArray("hot_nodes", [&] {
+      for (unsigned Node : Nodes)
+        J.object([&] {
+          J.attribute("node", int64_t(Node));
+          J.attribute("visits", int64_t(Stats.VisitsPerNode[Node]));
+        });
+    });
+  });
+  OS << "\n";
+}
+
+void reportSolverStats(StringRef Analysis, const Function &F, const DFASolverStats &Stats) {
+  if (!DFASolverStats::Enabled)
+    return;
+  NumSolverJoins += Stats.Joins;
+  NumSolverEqualityChecks += Stats.EqualityChecks;
+  NumSolverRequeues += Stats.Requeues;
+  NumSolverFactUpdates += Stats.FactUpdates;
+  MaxSolverFactSize.updateMax(Stats.MaxFactSize);
+  NumSolverInfoBytes += Stats.InfoBytes;
+
+  if (DFAStatsDir.empty())
+    return;
+  // Not reported: the statistics are a diagnostic and must not fail the pass
+  if (sys::fs::create_directories(DFAStatsDir))
+    return;
+  SmallString<128> Path(DFAStatsDir);
+  sys::path::append(Path, Analysis + "." + F.getName() + ".json");
+  std::error_code EC;
+  raw_fd_ostream OS(Path, EC);
+  if (!EC)
+    writeSolverStats(OS, Analysis, F, Stats);
+}
+
+// Open the output of the analyses, run Run on it, and flush it
+static void withOutput(raw_ostream &OS, function_ref<void(raw_ostream &)> Run) {
+  std::unique_ptr<raw_fd_ostream> File;
+  if (!DFAOutputFile.empty()) {
+    std::error_code EC;
+    File = std::make_unique<raw_fd_ostream>(DFAOutputFile, EC);
+    if (EC) {
+      errs() << "cse231: cannot open " << DFAOutputFile << ": " << EC.message() << "\n";
+      return;
+    }
+  }
+  raw_ostream &Out = File ? *File : OS;
+
+  // The facts are printed a token at a time, don't let each of them be a
+  // write to an unbuffered stream such as errs()
+  bool Unbuffered = Out.GetBufferSize() == 0;
+  if (Unbuffered)
+    Out.SetBufferSize(1 << 20);
+  if (DFAOutputFormat == DFABinaryOutput)
+    Out << cse231result::getFileHeader();
+  Run(Out);
+  Out.flush();
+  if (Unbuffered)
+    Out.SetUnbuffered();
+}
+
+void runOnFunctionsInParallel(Module &M, function_ref<void(Function &, raw_ostream &)> Body, raw_ostream &OS,
+                              StringRef CacheTag, function_ref<void(Function &, MD5 &)> CacheKey) {
+  withOutput(OS, [&](raw_ostream &Out) { runOnFunctions(M, Body, Out, CacheTag, CacheKey); });
+}
+
+void runOnCallGraphInParallel(Module &M, CallGraph &CG, function_ref<void(ArrayRef<CallGraphNode *>)> SCCBody,
+                              function_ref<void(Function &, raw_ostream &)> Body, raw_ostream &OS,
+                              StringRef CacheTag, function_ref<void(Function &, MD5 &)> CacheKey) {
+  withOutput(OS, [&](raw_ostream &Out) { runOnCallGraph(M, CG, SCCBody, Body, Out, CacheTag, CacheKey); });
+}
+
+}
@@ -1,376 +1,449 @@
-#include "231DFA.h"
+#include "ConstPropAnalysis.h"
 #include "llvm/Pass.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/IR/Function.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/GlobalVariable.h"
-#include "llvm/Analysis/CallGraphSCCPass.h"
 #include "llvm/Analysis/CallGraph.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/Support/TimeProfiler.h"
 #include <set>
 #include <map>
 #include <iostream>
+#include <mutex>
 
 using namespace llvm;
 
+#define DEBUG_TYPE "cse231-constprop"
+
+STATISTIC(NumWorklistIterations, "Number of worklist iterations");
+STATISTIC(NumFlowFunctionCalls, "Number of flow function calls");
+
+static cl::opt<GlobalModSummary::MPTKind> MPTMode("cse231-mpt", cl::init(GlobalModSummary::SyntacticMPT),
+    cl::desc("How -cse231-constprop finds the globals modified through pointers"),
+    cl::values(clEnumValN(GlobalModSummary::SyntacticMPT, "syntactic", "Every global whose address is taken (default)"),
+               clEnumValN(GlobalModSummary::SteensgaardMPT, "steensgaard", "Unification-based points-to analysis of the module")));
+
+static cl::opt<bool> SparseConstProp("cse231-constprop-sparse", cl::init(false),
+    cl::desc("Use sparse conditional constant propagation for -cse231-constprop"));
+
 namespace{
 
-    std::set<Value*> MPT;
-    std::set<GlobalVariable*> GlobMPT;
-    std::map<Function*, std::set<GlobalVariable*>> MOD;
+    GlobalModSummary MOD;
 
-    bool isPointerToPointer(Value* v){
-        Type* t=v->getType();
-        return t->isPointerTy() && t->getContainedType(0)->isPointerTy();
-    }
+    //Sparse conditional constant propagation over the same lattice as ConstPropAnalysis.
+    //SSA values keep one lattice cell each and are propagated along def-use chains; memory
+    //locations (pointer operands of loads and stores, including globals) are only kept at the
+    //entry and exit of basic blocks. Only CFG edges found executable are followed.
+    //The per-edge global facts are rebuilt by print() in the format of ConstPropAnalysis.
+    //Values are seeded as ConstPropAnalysis sees them, so that both prints compare: a value
+    //it never defines (an argument, a call, a cast, ...) and a location no store has defined
+    //hold bottom, and copy bottom into the locations they are stored to, but they are not
+    //constants for the instructions folding or branching on them (see getOperandState).
+    class SparseConstPropAnalysis{
+        private:
+            typedef ConstPropInfo::ConstVal ConstVal;
+            typedef std::map<Value*, ConstVal> MemoryState;
 
-    class ConstPropInfo:public Info{
-        public:
-            enum ConstState { Bottom, Const, Top };
-            struct ConstVal { 
-                ConstState state ; 
-                Constant* value;
-                ConstVal(){}
-                ConstVal(ConstState State,Constant* Value):state(State),value(Value){}
-                friend bool operator == (const ConstVal& left, const ConstVal& right){
-                    if(left.state==right.state){
-                        if(left.state==Top||left.state==Bottom)
-                            return true;
-                        else
-                            return left.value==right.value;
-                    }else{
-                        return false;
-                    }
-                }; 
-            };
+            ConstantFolder Folder;
+            Function* F;
+            const std::set<GlobalVariable*>& Globals;
+            //Lattice cell of each SSA value defined by an instruction, missing means bottom
+            DenseMap<Value*, ConstVal> Cells;
+            //Memory state at the entry and exit of each executable basic block
+            DenseMap<BasicBlock*, MemoryState> BlockIn;
+            DenseMap<BasicBlock*, MemoryState> BlockOut;
+            DenseSet<BasicBlock*> ExecutableBlocks;
+            DenseSet<std::pair<BasicBlock*, BasicBlock*>> ExecutableEdges;
+            SmallVector<BasicBlock*, 16> BlockWorklist;
+            SmallVector<Instruction*, 64> InstWorklist;
 
-            std::map<Value*, struct ConstVal> ConstPropContent;
+            static ConstVal top(){ return ConstVal(ConstPropInfo::Top,nullptr); }
+            static ConstVal bottom(){ return ConstVal(ConstPropInfo::Bottom,nullptr); }
 
-            ConstPropInfo(){}
-            ConstPropInfo(ConstVal val, std::set<GlobalVariable*> globVars){
-                for(auto& glob: globVars){
-                    ConstPropContent[glob]=val;
-                }
-            }
-            ConstPropInfo(const ConstPropInfo &other):Info(other){
-                ConstPropContent=other.ConstPropContent;
+            static ConstVal joinVal(const ConstVal& a, const ConstVal& b){
+                if(a.state==ConstPropInfo::Bottom)
+                    return b;
+                if(b.state==ConstPropInfo::Bottom)
+                    return a;
+                if(a.state==ConstPropInfo::Const && b.state==ConstPropInfo::Const && a.value==b.value)
+                    return a;
+                return top();
             }
-            //Implement virtual function of parent class to print reaching definition
-            void print(){
-                for(auto& iter:ConstPropContent){
-                    if(false==isa<GlobalVariable>(iter.first))
-                        continue;
-                    errs()<<iter.first->getName()<<"=";
-                    if(Bottom==iter.second.state){
-                        errs()<<"⊥";
-                    }else if(Top==iter.second.state){
-                        errs()<<"⊤";
-                    }else{
-                        errs()<<*iter.second.value;
-                    }
-                    errs()<<"|";
-                }
-                errs()<<"\n";
+
+            //Content of a location that no store on the path has written. ConstPropAnalysis keys
+            //a location by its pointer in the map of the values: globals start as top at the function
+            //entry, a pointer it defines itself (a load, a phi or a select) reads as its own value,
+            //top, and any other location is undefined (bottom)
+            static ConstVal defaultContent(Value* ptr){
+                if(isa<GlobalVariable>(ptr)||isa<LoadInst>(ptr)||isa<PHINode>(ptr)||isa<SelectInst>(ptr))
+                    return top();
+                return bottom();
             }
-            // Implement equal function 
-            static bool equals(ConstPropInfo* info1, ConstPropInfo* info2){
-                return info1->ConstPropContent==info2->ConstPropContent;
+
+            static ConstVal load(const MemoryState& state, Value* ptr){
+                auto iter=state.find(ptr);
+                return iter==state.end()?defaultContent(ptr):iter->second;
             }
-            //Implement join() function
-            static ConstPropInfo* join(ConstPropInfo* info1, ConstPropInfo* info2, ConstPropInfo* result){
-                for(auto& pair: info1->ConstPropContent){
-                    auto val1=pair.second;
-                    if(info2->ConstPropContent.find(pair.first)!=info2->ConstPropContent.end()){ //info2 also has this variable
-                        auto val2=info2->ConstPropContent[pair.first];
-                        if(val1.state==Top){
-                            result->ConstPropContent[pair.first]=ConstVal(Top,nullptr);   //still top
-                        }else if(val1.state==Const){
-                            if(val2.state==Top)
-                                result->ConstPropContent[pair.first]=ConstVal(Top,nullptr);   //still top
-                            else if(val2.state==Bottom)
-                                result->ConstPropContent[pair.first]=val1;           // result is the same with info1
-                            else{
-                                result->ConstPropContent[pair.first]=(val2==val1)?val1:ConstVal(Top,nullptr);  // if both const are the same, result is the same const, else top
-                            }
-                        }else{
-                            result->ConstPropContent[pair.first]=val2;   // if info1 is bottom, then the result will be whatever info2 is
-                        }
-                    }else{
-                        // result->ConstPropContent[pair.first]=ConstVal(Top,nullptr);
-                        result->ConstPropContent[pair.first]=val1;   
-                    }
+
+            static MemoryState joinState(const MemoryState& a, const MemoryState& b){
+                MemoryState result=a;
+                for(auto& pair: b){
+                    auto iter=result.find(pair.first);
+                    if(iter==result.end())
+                        result[pair.first]=joinVal(defaultContent(pair.first),pair.second);
+                    else
+                        iter->second=joinVal(iter->second,pair.second);
+                }
+                for(auto& pair: result){
+                    if(b.find(pair.first)==b.end())
+                        pair.second=joinVal(pair.second,defaultContent(pair.first));
                 }
                 return result;
             }
-    };
 
-    class ConstPropAnalysis: public DataFlowAnalysis<ConstPropInfo,true>{
-        private:
-            ConstantFolder Folder;
-            void flowfunction(Instruction * I,std::vector<unsigned> & IncomingEdges,std::vector<unsigned> & OutgoingEdges,std::vector<ConstPropInfo *> & InfoOut){
-                unsigned curNodeIndex=InstrToIndex[I];
-                std::string instrName=I->getOpcodeName();
-
-                //Join all infos on all incomingEdges
-                ConstPropInfo AllInfoIn=*EdgeToInfo[std::make_pair(IncomingEdges[0],curNodeIndex)];
-                for(auto edgeIndex: IncomingEdges){
-                    ConstPropInfo* tmpInfo=EdgeToInfo[std::make_pair(edgeIndex,curNodeIndex)];
-                    ConstPropInfo::join(&AllInfoIn,tmpInfo,&AllInfoIn);
+            //The state of v as a store copies it, bottom for the values without a cell
+            ConstVal getValueState(Value* v){
+                if(Constant* c=dyn_cast<Constant>(v))
+                    return ConstVal(ConstPropInfo::Const,c);
+                auto iter=Cells.find(v);
+                return iter==Cells.end()?bottom():iter->second;
+            }
+
+            //The state of v as an operand that is folded or branched on. ConstPropAnalysis folds
+            //constants only, so a bottom that stays bottom is top here: the values without a flow
+            //function in ConstPropAnalysis, and the loads that found their location undefined.
+            //Any other bottom is a value not evaluated yet.
+            ConstVal getOperandState(Value* v){
+                ConstVal val=getValueState(v);
+                if(val.state!=ConstPropInfo::Bottom)
+                    return val;
+                Instruction* I=dyn_cast<Instruction>(v);
+                if(!I)
+                    return top();
+                if(isa<LoadInst>(I))
+                    return Cells.count(I)?top():val;
+                if(isa<BinaryOperator>(I)||isa<UnaryOperator>(I)||isa<CmpInst>(I)||isa<SelectInst>(I)||isa<PHINode>(I))
+                    return val;
+                return top();
+            }
+
+            void pushBlock(BasicBlock* block){
+                if(ExecutableBlocks.count(block))
+                    BlockWorklist.push_back(block);
+            }
+
+            //Lower the cell of I to include val, and revisit the users of I if it changed
+            void mergeCell(Instruction* I, ConstVal val){
+                ConstVal old=getValueState(I);
+                ConstVal merged=joinVal(old,val);
+                if(merged==old && Cells.count(I))
+                    return;
+                Cells[I]=merged;
+                if(merged==old)
+                    return;
+                for(User* user: I->users()){
+                    Instruction* userInstr=dyn_cast<Instruction>(user);
+                    if(!userInstr || !ExecutableBlocks.count(userInstr->getParent()))
+                        continue;
+                    if(isa<LoadInst>(userInstr)||isa<StoreInst>(userInstr)||isa<CallInst>(userInstr)||userInstr->isTerminator())
+                        pushBlock(userInstr->getParent());     //these depend on the memory state or the CFG, revisit the whole block
+                    else
+                        InstWorklist.push_back(userInstr);
                 }
+            }
 
-                //Flowfunction for binary operator
+            //Evaluate an instruction that only reads SSA values. The ones without a flow function
+            //in ConstPropAnalysis keep no cell.
+            void visitPure(Instruction* I){
                 if(BinaryOperator* binOp=dyn_cast<BinaryOperator>(I)){
-                    Value* x=I->getOperand(0);
-                    Value* y=I->getOperand(1);
-                    Constant* x_const=dyn_cast<Constant>(x);
-                    Constant* y_const=dyn_cast<Constant>(y);
-                    if(!x_const){
-                        if(AllInfoIn.ConstPropContent.find(x)!=AllInfoIn.ConstPropContent.end()
-                            && AllInfoIn.ConstPropContent[x].state==ConstPropInfo::Const)
-                            x_const=AllInfoIn.ConstPropContent[x].value;
-                    }
-                    if(!y_const){
-                        if(AllInfoIn.ConstPropContent.find(y)!=AllInfoIn.ConstPropContent.end()
-                            && AllInfoIn.ConstPropContent[y].state==ConstPropInfo::Const)
-                            y_const=AllInfoIn.ConstPropContent[y].value;
-                    }
-                    if(x_const && y_const){
-                        AllInfoIn.ConstPropContent[I]=ConstPropInfo::ConstVal(ConstPropInfo::Const,Folder.CreateBinOp(binOp->getOpcode(),x_const,y_const));
-                    }else{
-                        AllInfoIn.ConstPropContent[I]=ConstPropInfo::ConstVal(ConstPropInfo::Top,nullptr);
-                    }
-                }
-                //Flowfunction for unary operator
-                else if(UnaryOperator* unaOp=dyn_cast<UnaryOperator>(I)){
-                    Value* x=I->getOperand(0);
-                    Constant* x_const=dyn_cast<Constant>(x);
-                    if(!x_const){
-                        if(AllInfoIn.ConstPropContent.find(x)!=AllInfoIn.ConstPropContent.end()
-                            && AllInfoIn.ConstPropContent[x].state==ConstPropInfo::Const)
-                            x_const=AllInfoIn.ConstPropContent[x].value;
+                    ConstVal x=getOperandState(I->getOperand(0)), y=getOperandState(I->getOperand(1));
+                    if(x.state==ConstPropInfo::Const && y.state==ConstPropInfo::Const){
+                        std::lock_guard<std::mutex> lock(getFolderMutex());
+                        mergeCell(I,ConstVal(ConstPropInfo::Const,Folder.CreateBinOp(binOp->getOpcode(),x.value,y.value)));
+                    }else if(x.state==ConstPropInfo::Top || y.state==ConstPropInfo::Top){
+                        mergeCell(I,top());
                     }
-                    if(x_const){
-                        AllInfoIn.ConstPropContent[I]=ConstPropInfo::ConstVal(ConstPropInfo::Const,Folder.CreateUnOp(unaOp->getOpcode(),x_const));
-                    }else{
-                        AllInfoIn.ConstPropContent[I]=ConstPropInfo::ConstVal(ConstPropInfo::Top,nullptr);
+                }else if(UnaryOperator* unaOp=dyn_cast<UnaryOperator>(I)){
+                    ConstVal x=getOperandState(I->getOperand(0));
+                    if(x.state==ConstPropInfo::Const){
+                        std::lock_guard<std::mutex> lock(getFolderMutex());
+                        mergeCell(I,ConstVal(ConstPropInfo::Const,Folder.CreateUnOp(unaOp->getOpcode(),x.value)));
+                    }else if(x.state==ConstPropInfo::Top){
+                        mergeCell(I,top());
                     }
-                }
-                //Flowfunction for compare operator
-                else if(CmpInst* cmpOp=dyn_cast<CmpInst>(I)){
-                    Value* x=I->getOperand(0);
-                    Value* y=I->getOperand(1);
-                    Constant* x_const=dyn_cast<Constant>(x);
-                    Constant* y_const=dyn_cast<Constant>(y);
-                    if(!x_const){
-                        if(AllInfoIn.ConstPropContent.find(x)!=AllInfoIn.ConstPropContent.end()
-                            && AllInfoIn.ConstPropContent[x].state==ConstPropInfo::Const)
-                            x_const=AllInfoIn.ConstPropContent[x].value;
-                    }
-                    if(!y_const){
-                        if(AllInfoIn.ConstPropContent.find(y)!=AllInfoIn.ConstPropContent.end()
-                            && AllInfoIn.ConstPropContent[y].state==ConstPropInfo::Const)
-                            y_const=AllInfoIn.ConstPropContent[y].value;
-                    }
-                    if(x_const && y_const){
-                        if(instrName=="icmp")
-                            AllInfoIn.ConstPropContent[I]=ConstPropInfo::ConstVal(ConstPropInfo::Const,Folder.CreateICmp(cmpOp->getPredicate(),x_const,y_const));
+                }else if(CmpInst* cmpOp=dyn_cast<CmpInst>(I)){
+                    ConstVal x=getOperandState(I->getOperand(0)), y=getOperandState(I->getOperand(1));
+                    if(x.state==ConstPropInfo::Const && y.state==ConstPropInfo::Const){
+                        std::lock_guard<std::mutex> lock(getFolderMutex());
+                        if(isa<ICmpInst>(cmpOp))
+                            mergeCell(I,ConstVal(ConstPropInfo::Const,Folder.CreateICmp(cmpOp->getPredicate(),x.value,y.value)));
                         else
-                            AllInfoIn.ConstPropContent[I]=ConstPropInfo::ConstVal(ConstPropInfo::Const,Folder.CreateFCmp(cmpOp->getPredicate(),x_const,y_const));
-                    }else{
-                        AllInfoIn.ConstPropContent[I]=ConstPropInfo::ConstVal(ConstPropInfo::Top,nullptr);
-                    }
-                }
-                //Flowfunction for select operator
-                else if(SelectInst* selOp=dyn_cast<SelectInst>(I)){
-                    Value* x=I->getOperand(0);
-                    Value* y=I->getOperand(1);
-                    Constant* x_const=dyn_cast<Constant>(x);
-                    Constant* y_const=dyn_cast<Constant>(y);
-                    if(!x_const){
-                        if(AllInfoIn.ConstPropContent.find(x)!=AllInfoIn.ConstPropContent.end()
-                            && AllInfoIn.ConstPropContent[x].state==ConstPropInfo::Const)
-                            x_const=AllInfoIn.ConstPropContent[x].value;
-                    }
-                    if(!y_const){
-                        if(AllInfoIn.ConstPropContent.find(y)!=AllInfoIn.ConstPropContent.end()
-                            && AllInfoIn.ConstPropContent[y].state==ConstPropInfo::Const)
-                            y_const=AllInfoIn.ConstPropContent[y].value;
+                            mergeCell(I,ConstVal(ConstPropInfo::Const,Folder.CreateFCmp(cmpOp->getPredicate(),x.value,y.value)));
+                    }else if(x.state==ConstPropInfo::Top || y.state==ConstPropInfo::Top){
+                        mergeCell(I,top());
                     }
-                    if(x_const && y_const){
-                        if(Constant* condition=dyn_cast<Constant>(selOp->getCondition()))
-                            AllInfoIn.ConstPropContent[I]=ConstPropInfo::ConstVal(ConstPropInfo::Const,Folder.CreateSelect(condition,x_const,y_const));
-                    }else{
-                        AllInfoIn.ConstPropContent[I]=ConstPropInfo::ConstVal(ConstPropInfo::Top,nullptr);
+                }else if(SelectInst* selOp=dyn_cast<SelectInst>(I)){
+                    ConstVal cond=getOperandState(selOp->getCondition());
+                    if(cond.state==ConstPropInfo::Const && isa<ConstantInt>(cond.value)){
+                        mergeCell(I,getOperandState(cast<ConstantInt>(cond.value)->isOne()?selOp->getTrueValue():selOp->getFalseValue()));
+                    }else if(cond.state!=ConstPropInfo::Bottom){
+                        mergeCell(I,joinVal(getOperandState(selOp->getTrueValue()),getOperandState(selOp->getFalseValue())));
                     }
-                }
-                //Flowfunction for call instruction
-                else if(CallInst* callOp=dyn_cast<CallInst>(I)){
-                    for(auto& glob: MOD[callOp->getCalledFunction()]){
-                        AllInfoIn.ConstPropContent[glob]=ConstPropInfo::ConstVal(ConstPropInfo::Top,nullptr);
-                    }
-                }
-                //Flowfunction for load instruction
-                else if(LoadInst* loadOp=dyn_cast<LoadInst>(I)){
-                    if(!I->getType()->isPointerTy()){
-                        AllInfoIn.ConstPropContent[I]=AllInfoIn.ConstPropContent[loadOp->getPointerOperand()];
-                    }else{
-                        AllInfoIn.ConstPropContent[I]=ConstPropInfo::ConstVal(ConstPropInfo::Top,nullptr);
+                }else if(PHINode* phiNode=dyn_cast<PHINode>(I)){
+                    //Only the incoming values of executable edges contribute
+                    ConstVal val=bottom();
+                    for(unsigned i=0;i<phiNode->getNumIncomingValues();++i){
+                        if(ExecutableEdges.count(std::make_pair(phiNode->getIncomingBlock(i),phiNode->getParent())))
+                            val=joinVal(val,getOperandState(phiNode->getIncomingValue(i)));
                     }
+                    if(val.state!=ConstPropInfo::Bottom)
+                        mergeCell(I,val);
                 }
-                //Flowfunction for store instruction
-                else if(StoreInst* storeOp=dyn_cast<StoreInst>(I)){
+            }
+
+            //Apply the flow function of I to the memory state; the SSA result goes to the cells
+            void transfer(Instruction* I, MemoryState& state){
+                if(LoadInst* loadOp=dyn_cast<LoadInst>(I)){
+                    if(!I->getType()->isPointerTy())
+                        mergeCell(I,load(state,loadOp->getPointerOperand()));
+                    else
+                        mergeCell(I,top());
+                }else if(StoreInst* storeOp=dyn_cast<StoreInst>(I)){
                     Value* src=storeOp->getValueOperand();
                     Value* dst=storeOp->getPointerOperand();
-                    if(Constant* srcVal=dyn_cast<Constant>(src)){
-                        AllInfoIn.ConstPropContent[dst]=ConstPropInfo::ConstVal(ConstPropInfo::Const,srcVal);
-                    }else{
-                        if(!src->getType()->isPointerTy()){
-                            AllInfoIn.ConstPropContent[dst]=AllInfoIn.ConstPropContent[src];
-                        }
+                    if(Constant* srcVal=dyn_cast<Constant>(src))
+                        state[dst]=ConstVal(ConstPropInfo::Const,srcVal);
+                    else if(!src->getType()->isPointerTy())
+                        state[dst]=getValueState(src);
+                }else if(CallInst* callOp=dyn_cast<CallInst>(I)){
+                    if(const BitVector* mod=MOD.getModifiedGlobals(callOp->getCalledFunction())){
+                        for(unsigned globId: mod->set_bits())
+                            state[MOD.getGlobal(globId)]=top();
                     }
+                }else{
+                    visitPure(I);
                 }
-                //Flowfunction for Phi instruction
-                else if(PHINode* phiOp=dyn_cast<PHINode>(I)){
-                    unsigned nonPhiIndex=InstrToIndex[I->getParent()->getFirstNonPHI()];
-                    for(unsigned i=curNodeIndex;i<nonPhiIndex;i++){
-                        PHINode* phiNode=dyn_cast<PHINode>(IndexToInstr[i]);
-                        unsigned phiOperandNum=phiNode->getNumIncomingValues();
-                        ConstPropInfo::ConstVal prevConstVal;
-                        if(isa<Constant>(phiNode->getIncomingValue(0))){
-                            prevConstVal.state=ConstPropInfo::Const;
-                            prevConstVal.value=dyn_cast<Constant>(phiNode->getIncomingValue(0));
-                        }else{
-                            prevConstVal.state=ConstPropInfo::Top;
-                            prevConstVal.value=nullptr;
-                        }
-                        bool sameFlag=true;
-                        for(unsigned j=1;j<phiOperandNum;j++){
-                            if(Value* val=dyn_cast<Constant>(phiNode->getIncomingValue(j))){
-                                if(val!=prevConstVal.value){
-                                    sameFlag=false;
-                                    break;
-                                }
-                            }else{
-                                sameFlag=false;
-                                break;
-                            }
-                        }
-                        if(sameFlag){
-                            AllInfoIn.ConstPropContent[IndexToInstr[i]]=prevConstVal;
-                        }else{
-                            AllInfoIn.ConstPropContent[IndexToInstr[i]]=ConstPropInfo::ConstVal(ConstPropInfo::Top,nullptr);
+            }
+
+            void markEdgeExecutable(BasicBlock* src, BasicBlock* dst){
+                if(!ExecutableEdges.insert(std::make_pair(src,dst)).second){
+                    BlockWorklist.push_back(dst);     //already executable, but the state flowing on it changed
+                    return;
+                }
+                ExecutableBlocks.insert(dst);
+                BlockWorklist.push_back(dst);
+            }
+
+            //Successors reachable from the terminator of block given the current cells
+            void getFeasibleSuccessors(BasicBlock* block, SmallVectorImpl<BasicBlock*>& succs){
+                Instruction* term=block->getTerminator();
+                if(BranchInst* br=dyn_cast<BranchInst>(term)){
+                    if(br->isConditional()){
+                        ConstVal cond=getOperandState(br->getCondition());
+                        if(cond.state==ConstPropInfo::Bottom)
+                            return;
+                        if(cond.state==ConstPropInfo::Const && isa<ConstantInt>(cond.value)){
+                            succs.push_back(br->getSuccessor(cast<ConstantInt>(cond.value)->isOne()?0:1));
+                            return;
                         }
                     }
+                }else if(SwitchInst* sw=dyn_cast<SwitchInst>(term)){
+                    ConstVal cond=getOperandState(sw->getCondition());
+                    if(cond.state==ConstPropInfo::Bottom)
+                        return;
+                    if(cond.state==ConstPropInfo::Const && isa<ConstantInt>(cond.value)){
+                        succs.push_back(sw->findCaseValue(cast<ConstantInt>(cond.value))->getCaseSuccessor());
+                        return;
+                    }
                 }
-                
-                for(unsigned i=0;i<InfoOut.size();++i){
-                    InfoOut[i]->ConstPropContent=AllInfoIn.ConstPropContent;
-                }
+                for(BasicBlock* succ: successors(block))
+                    succs.push_back(succ);
             }
-        public:
-            //the constructor which explicitly call the constructor of parent class
-            ConstPropAnalysis(ConstPropInfo& bottom, ConstPropInfo& initialState):DataFlowAnalysis(bottom,initialState){}
-
-    };
-
 
+            MemoryState entryState(){
+                MemoryState state;
+                for(GlobalVariable* glob: Globals)
+                    state[glob]=top();
+                return state;
+            }
 
-    struct ConstPropAnalysisPass:public CallGraphSCCPass {
-        static char ID;
-        ConstPropAnalysisPass() : CallGraphSCCPass(ID) {}
+            void visitBlock(BasicBlock* block){
+                MemoryState state;
+                bool first=true;
+                if(block==&F->getEntryBlock()){
+                    state=entryState();
+                    first=false;
+                }
+                for(BasicBlock* pred: predecessors(block)){
+                    if(!ExecutableEdges.count(std::make_pair(pred,block)))
+                        continue;
+                    state=first?BlockOut[pred]:joinState(state,BlockOut[pred]);
+                    first=false;
+                }
+                BlockIn[block]=state;
 
-        bool doInitialization(CallGraph &CG) override{
-            auto& globalVariableList=CG.getModule().getGlobalList();
+                for(Instruction& instr: *block)
+                    transfer(&instr,state);
 
-            //********************MPT Analysis***********************
-            //global variable initialization reference
-            for(auto& variable: globalVariableList){
-                if(isa<GlobalVariable>(variable.getInitializer()))
-                    MPT.insert(dyn_cast<GlobalVariable>(variable.getInitializer()));    // dyn_cast may fail, so may need to use try catch?
-            }
-            //local variable, function parameter and return value
-            for(auto& func: CG.getModule().functions()){
-                for(auto& block: func){
-                    for(auto& instr: block){
-                        if(isa<StoreInst>(instr)){     // local variable initialization reference
-                            Value* srcVal=(dyn_cast<StoreInst>(&instr))->getValueOperand();
-                            if(false==isa<Constant>(srcVal))
-                                MPT.insert(srcVal);
-                        }else if(isa<CallInst>(instr)){
-                            for(Use& operand: instr.operands()){
-                                MPT.insert(operand);            // reference parameters in function call
-                            }
-                        }else if(isa<ReturnInst>(instr)){
-                            for(Use& operand: instr.operands()){
-                                MPT.insert(operand);            // return value reference
-                            }
-                        }
+                auto outIter=BlockOut.find(block);
+                bool outChanged=false;
+                if(outIter==BlockOut.end()){
+                    BlockOut[block]=state;
+                    outChanged=true;
+                }else{
+                    MemoryState merged=joinState(outIter->second,state);
+                    if(merged!=outIter->second){
+                        outIter->second=merged;
+                        outChanged=true;
                     }
                 }
-            }
-            //get global variables in MPT set and form GlobMPT set
-            for(auto& var: MPT){
-                if(isa<GlobalVariable>(var)){
-                    GlobMPT.insert(dyn_cast<GlobalVariable>(var));
+
+                SmallVector<BasicBlock*, 4> succs;
+                getFeasibleSuccessors(block,succs);
+                for(BasicBlock* succ: succs){
+                    if(outChanged || !ExecutableEdges.count(std::make_pair(block,succ)))
+                        markEdgeExecutable(block,succ);
                 }
             }
 
-            //********************LMOD Analysis***********************
-            for(auto& func: CG.getModule().functions()){
-                for(auto& block: func){
-                    for(auto& instr: block){
-                        if(isa<StoreInst>(instr)){
-                            Value* dstVal=(dyn_cast<StoreInst>(&instr))->getPointerOperand();
-                            if(isa<GlobalVariable>(dstVal))
-                                MOD[&func].insert(dyn_cast<GlobalVariable>(dstVal));    //global variable is directly modified
-                            else if(isPointerToPointer(dstVal)){
-                                MOD[&func].insert(GlobMPT.begin(),GlobMPT.end());       //dereference pointer is modified
-                            }
-                        }
+        public:
+            SparseConstPropAnalysis(Function* func, const std::set<GlobalVariable*>& globals):F(func),Globals(globals){}
+
+            void run(){
+                TimeTraceScope traceScope("CSE231SparseSolve");
+                ExecutableBlocks.insert(&F->getEntryBlock());
+                BlockWorklist.push_back(&F->getEntryBlock());
+                while(!BlockWorklist.empty() || !InstWorklist.empty()){
+                    while(!InstWorklist.empty()){
+                        Instruction* I=InstWorklist.pop_back_val();
+                        visitPure(I);
                     }
+                    if(!BlockWorklist.empty())
+                        visitBlock(BlockWorklist.pop_back_val());
                 }
             }
 
-            return false;
-        }
+            //Print the global facts of every instruction edge, as ConstPropAnalysis::print does.
+            //Edges out of blocks or along edges that never execute carry bottom.
+            //Blocks are numbered in layout order, so printing block by block keeps the (source, destination) order.
+            void print(raw_ostream& OS){
+                TimeTraceScope traceScope("CSE231Print");
+                DenseMap<Instruction*, unsigned> index;
+                unsigned counter=1;
+                for(Instruction& instr: instructions(F))
+                    index[&instr]=counter++;
+
+                bool binary=DFAOutputFormat==DFABinaryOutput;
+                cse231result::FunctionWriter W(F->getName());
+                std::shared_ptr<ConstPropInfo::ConstMap::Factory> factory=std::make_shared<ConstPropInfo::ConstMap::Factory>(false);
+                auto printEdge=[&](unsigned src, unsigned dst, const MemoryState* state){
+                    ConstPropInfo info(factory);
+                    for(GlobalVariable* glob: Globals)
+                        info.set(glob,state?load(*state,glob):bottom());
+                    if(binary){
+                        W.beginEdge(src,dst);
+                        info.write(W);
+                        return;
+                    }
+                    OS<<"Edge "<<src<<"->" "Edge "<<dst<<":";
+                    info.print(OS);
+                };
 
-        bool runOnSCC(CallGraphSCC &SCC) override{
-            //********************CMOD Analysis***********************
-            std::set<GlobalVariable*> tmpSet;
-        
-            for(auto& callerNode: SCC){
-                Function* caller=callerNode->getFunction();
-                for(auto& record: *callerNode){      // get callee info outside current SCC (callee info inside current SCC is also involved, but doesn't matter)
-                    Function* callee=record.second->getFunction();
-                    if(MOD.find(callee)!=MOD.end())
-                        MOD[caller].insert(MOD[callee].begin(),MOD[callee].end());
+                MemoryState initial=entryState();
+                printEdge(0,index[&F->getEntryBlock().front()],&initial);
+                for(BasicBlock& block: *F){
+                    bool executable=ExecutableBlocks.count(&block);
+                    MemoryState state;
+                    if(executable)
+                        state=BlockIn[&block];
+                    //Replay the flow functions of the block to get the state after each node
+                    Instruction* lastPhi=block.getFirstNonPHI()->getPrevNode();
+                    for(Instruction& instr: block){
+                        if(executable)
+                            transfer(&instr,state);
+                        if(instr.isTerminator())
+                            break;
+                        if(isa<PHINode>(&instr) && &instr!=lastPhi)
+                            continue;
+                        unsigned src=isa<PHINode>(&instr)?index[&block.front()]:index[&instr];
+                        printEdge(src,index[instr.getNextNode()],executable?&state:nullptr);
+                    }
+
+                    std::map<unsigned, BasicBlock*> succs;
+                    for(BasicBlock* succ: successors(&block))
+                        succs[index[&succ->front()]]=succ;
+                    for(auto& succ: succs){
+                        bool taken=ExecutableEdges.count(std::make_pair(&block,succ.second));
+                        printEdge(index[block.getTerminator()],succ.first,taken?&BlockOut[&block]:nullptr);
+                    }
                 }
-                //union info of each caller function to solve the loop issue
-                tmpSet.insert(MOD[caller].begin(),MOD[caller].end());
+                if(binary)
+                    OS<<W.finish();
             }
+    };
 
-            for(auto& callerNode: SCC){
-                Function* caller=callerNode->getFunction();
-                MOD[caller]=tmpSet;
-            }
+    struct ConstPropAnalysisPass:public ModulePass {
+        static char ID;
+        ConstPropAnalysisPass() : ModulePass(ID) {}
 
-            return false;
+        void getAnalysisUsage(AnalysisUsage &AU) const override{
+            AU.addRequired<CallGraphWrapperPass>();
+            AU.setPreservesAll();
         }
 
-        bool doFinalization(CallGraph &CG) override{
+        bool runOnModule(Module &M) override{
+            CallGraph &CG=getAnalysis<CallGraphWrapperPass>().getCallGraph();
+            //MPT and LMOD, the SCCs complete it bottom-up with CMOD
+            MOD.computeLocal(M,MPTMode);
+
             std::set<GlobalVariable*> globSet;
-            for(auto& glob: CG.getModule().getGlobalList()){
+            for(auto& glob: M.getGlobalList()){
                 globSet.insert(&glob);
             }
 
-            for(Function& F: CG.getModule().functions()){
+            //a function is analyzed as soon as the SCCs of its callees are merged, so CMOD
+            //and the solves overlap; the results are still printed in module order
+            runOnCallGraphInParallel(M,CG,[](ArrayRef<CallGraphNode*> SCC){
+                MOD.mergeSCC(SCC);
+            },[&globSet](Function& F,raw_ostream &OS){
+                if(SparseConstProp){
+                    SparseConstPropAnalysis analysis(&F,globSet);
+                    analysis.run();
+                    analysis.print(OS);
+                    return;
+                }
                 ConstPropInfo bottom=ConstPropInfo(ConstPropInfo::ConstVal(ConstPropInfo::Bottom,nullptr),globSet);
                 ConstPropInfo initialState=ConstPropInfo(ConstPropInfo::ConstVal(ConstPropInfo::Top,nullptr),globSet);
-                ConstPropAnalysis analysis=ConstPropAnalysis(bottom,initialState);
+                ConstPropAnalysis analysis(bottom,initialState,MOD);
+                analysis.setBlockGranularity(DFABlockGranularity);
                 analysis.runWorklistAlgorithm(&F);
-                analysis.print();
-            }
+                NumWorklistIterations+=analysis.getNumWorklistIterations();
+                NumFlowFunctionCalls+=analysis.getNumFlowFunctionCalls();
+                reportSolverStats("constprop",F,analysis.getSolverStats());
+                analysis.print(OS);
+            },errs(),SparseConstProp?"constprop-sparse":"constprop",[](Function& F,MD5& hash){
+                //the output also depends on the globals of the module and on what the callees may modify
+                for(unsigned globId=0;globId<MOD.getNumGlobals();globId++){
+                    hash.update(MOD.getGlobal(globId)->getName());
+                    hash.update(",");
+                }
+                for(Instruction& I: instructions(F)){
+                    if(CallInst* callOp=dyn_cast<CallInst>(&I)){
+                        if(const BitVector* mod=MOD.getModifiedGlobals(callOp->getCalledFunction())){
+                            for(unsigned globId: mod->set_bits()){
+                                hash.update(MOD.getGlobal(globId)->getName());
+                                hash.update(",");
+                            }
+                        }
+                        hash.update(";");   //end of the set of this call
+                    }
+                }
+            });
             return false;
         }
     };
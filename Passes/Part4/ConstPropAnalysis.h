@@ -0,0 +1,382 @@
+//===- ConstPropAnalysis.h - Constant propagation analysis ------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file provides the lattice and the dense dataflow analysis of the
+// CSE 231 constant propagation. The MOD summary the analysis needs is built
+// beforehand, see GlobalModSummary.h.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_231CONSTPROPANALYSIS_H
+#define LLVM_TRANSFORMS_231CONSTPROPANALYSIS_H
+
+#include "231DFA.h"
+#include "GlobalModSummary.h"
+#include "llvm/ADT/ImmutableMap.h"
+#include "llvm/IR/ConstantFolder.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace llvm {
+
+    //ConstantFolder creates constants in the LLVMContext shared by all threads, guard it
+    inline std::mutex& getFolderMutex(){
+        static std::mutex FolderMutex;
+        return FolderMutex;
+    }
+
+    class ConstPropInfo final:public Info{
+        public:
+            enum ConstState { Bottom, Const, Top };
+            struct ConstVal { 
+                ConstState state ; 
+                Constant* value;
+                ConstVal():state(Bottom),value(nullptr){}     //cells created by a lookup of an unseen value start at bottom
+                ConstVal(ConstState State,Constant* Value):state(State),value(Value){}
+                friend bool operator == (const ConstVal& left, const ConstVal& right){
+                    if(left.state==right.state){
+                        if(left.state==Top||left.state==Bottom)
+                            return true;
+                        else
+                            return left.value==right.value;
+                    }else{
+                        return false;
+                    }
+                }; 
+                void Profile(FoldingSetNodeID& ID) const{
+                    ID.AddInteger(state);
+                    ID.AddPointer(value);
+                }
+            };
+            typedef ImmutableMap<Value*, ConstVal> ConstMap;
+
+            //Owner of the trees of ConstPropContent, shared by all the facts of one analysis
+            std::shared_ptr<ConstMap::Factory> Factory;
+            //Persistent map: a copy shares the tree, and an update copies only the path to its entry
+            ConstMap ConstPropContent;
+
+            ConstPropInfo():ConstPropContent(nullptr){}
+            explicit ConstPropInfo(std::shared_ptr<ConstMap::Factory> factory):Factory(factory),ConstPropContent(factory->getEmptyMap()){}
+            ConstPropInfo(ConstVal val, std::set<GlobalVariable*> globVars):Factory(std::make_shared<ConstMap::Factory>(false)),ConstPropContent(Factory->getEmptyMap()){
+                for(auto& glob: globVars){
+                    set(glob,val);
+                }
+            }
+            ConstPropInfo(const ConstPropInfo &other):Info(other),Factory(other.Factory),ConstPropContent(other.ConstPropContent){}
+            ConstPropInfo& operator=(const ConstPropInfo &other){
+                ConstPropContent=other.ConstPropContent;    //release the old tree while its factory is alive
+                Factory=other.Factory;
+                return *this;
+            }
+            //The value of V, bottom if it has none
+            ConstVal get(Value* V) const{
+                const ConstVal* val=ConstPropContent.lookup(V);
+                return val?*val:ConstVal();
+            }
+            void set(Value* V, ConstVal val){
+                ConstPropContent=Factory->add(ConstPropContent,V,val);
+            }
+            //Rebuild the map in factory, all the facts an analysis joins must share one factory
+            void setFactory(std::shared_ptr<ConstMap::Factory> factory){
+                ConstMap map=factory->getEmptyMap();
+                for(auto& iter:ConstPropContent)
+                    map=factory->add(map,iter.first,iter.second);
+                ConstPropContent=map;
+                Factory=factory;
+            }
+            //Implement virtual function of parent class to print reaching definition
+            void print(raw_ostream &OS) override{
+                for(auto& iter:ConstPropContent){
+                    if(false==isa<GlobalVariable>(iter.first))
+                        continue;
+                    OS<<iter.first->getName()<<"=";
+                    if(Bottom==iter.second.state){
+                        OS<<"⊥";
+                    }else if(Top==iter.second.state){
+                        OS<<"⊤";
+                    }else{
+                        OS<<*iter.second.value;
+                    }
+                    OS<<"|";
+                }
+                OS<<"\n";
+            }
+            void write(cse231result::FunctionWriter &W) override{
+                std::vector<cse231result::FunctionWriter::ConstEntry> entries;
+                for(auto& iter:ConstPropContent){
+                    if(false==isa<GlobalVariable>(iter.first))
+                        continue;
+                    cse231result::FunctionWriter::ConstEntry entry;
+                    entry.Name=iter.first->getName().str();
+                    if(Bottom==iter.second.state){
+                        entry.State=cse231result::BottomState;
+                    }else if(Top==iter.second.state){
+                        entry.State=cse231result::TopState;
+                    }else{
+                        entry.State=cse231result::ValueState;
+                        raw_string_ostream value(entry.Value);
+                        value<<*iter.second.value;
+                    }
+                    entries.push_back(entry);
+                }
+                W.writeConstMap(entries);
+            }
+            unsigned size() override{
+                unsigned n=0;
+                for(auto iter=ConstPropContent.begin();iter!=ConstPropContent.end();++iter)
+                    n++;
+                return n;
+            }
+            // Implement equal function, subtrees shared by both maps are skipped
+            static bool equals(ConstPropInfo* info1, ConstPropInfo* info2){
+                return info1->ConstPropContent==info2->ConstPropContent;
+            }
+            //Implement join() function, the variables of info1 are kept and joined with their value in info2
+            static ConstPropInfo* join(ConstPropInfo* info1, ConstPropInfo* info2, ConstPropInfo* result){
+                std::shared_ptr<ConstMap::Factory> factory=info1->Factory?info1->Factory:info2->Factory;
+                ConstMap joined=info1->ConstPropContent;
+                //walk both trees in the order of the variables, skipping the subtrees they share
+                ConstMap::TreeTy::iterator iter1(info1->ConstPropContent.getRootWithoutRetain()),iter2(info2->ConstPropContent.getRootWithoutRetain()),end;
+                while(iter1!=end && iter2!=end){
+                    if(&*iter1==&*iter2){
+                        iter1.skipSubTree();
+                        iter2.skipSubTree();
+                        continue;
+                    }
+                    Value* var=iter1->getValue().first;
+                    if(iter2->getValue().first<var){
+                        ++iter2;
+                        continue;
+                    }
+                    if(var<iter2->getValue().first){    //only info1 has this variable, keep it
+                        ++iter1;
+                        continue;
+                    }
+                    const ConstVal& val1=iter1->getValue().second;
+                    const ConstVal& val2=iter2->getValue().second;
+                    ConstVal val=val1;
+                    if(val1.state==Top){
+                        //still top
+                    }else if(val1.state==Const){
+                        if(val2.state==Top)
+                            val=ConstVal(Top,nullptr);  //still top
+                        else if(val2.state==Const && !(val2==val1))
+                            val=ConstVal(Top,nullptr);  //two different constants
+                    }else{
+                        val=val2;   // if info1 is bottom, then the result will be whatever info2 is
+                    }
+                    if(!(val==val1))
+                        joined=factory->add(joined,var,val);
+                    ++iter1;
+                    ++iter2;
+                }
+                result->ConstPropContent=joined;
+                result->Factory=factory;
+                return result;
+            }
+            //Implement joinInto() function, dst becomes join(src,dst): the variables of src are kept
+            static bool joinInto(ConstPropInfo* src, ConstPropInfo* dst){
+                ConstPropInfo joined;
+                join(src,dst,&joined);
+                if(equals(&joined,dst))
+                    return false;
+                *dst=joined;
+                return true;
+            }
+    };
+
+    class ConstPropAnalysis final: public DataFlowAnalysis<ConstPropInfo,true,ConstPropAnalysis>{
+        private:
+            //The solver calls flowfunction statically, see DataFlowAnalysis
+            friend class DataFlowAnalysis<ConstPropInfo,true,ConstPropAnalysis>;
+            ConstantFolder Folder;
+            //The globals each callee may modify, final before the solve
+            const GlobalModSummary& Mod;
+            void flowfunction(Instruction * I,std::vector<unsigned> & IncomingEdges,std::vector<unsigned> & OutgoingEdges,std::vector<ConstPropInfo *> & InfoOut) override{
+                unsigned curNodeIndex=InstrToIndex[I];
+
+                //Join all infos on all incomingEdges
+                ConstPropInfo AllInfoIn=*getEdgeInfo(IncomingEdges[0],curNodeIndex);
+                for(auto edgeIndex: IncomingEdges){
+                    ConstPropInfo* tmpInfo=getEdgeInfo(edgeIndex,curNodeIndex);
+                    ConstPropInfo::join(&AllInfoIn,tmpInfo,&AllInfoIn);
+                }
+
+                //Flowfunction for binary operator
+                if(BinaryOperator* binOp=dyn_cast<BinaryOperator>(I)){
+                    Value* x=I->getOperand(0);
+                    Value* y=I->getOperand(1);
+                    Constant* x_const=dyn_cast<Constant>(x);
+                    Constant* y_const=dyn_cast<Constant>(y);
+                    if(!x_const){
+                        ConstPropInfo::ConstVal x_val=AllInfoIn.get(x);
+                        if(x_val.state==ConstPropInfo::Const)
+                            x_const=x_val.value;
+                    }
+                    if(!y_const){
+                        ConstPropInfo::ConstVal y_val=AllInfoIn.get(y);
+                        if(y_val.state==ConstPropInfo::Const)
+                            y_const=y_val.value;
+                    }
+                    if(x_const && y_const){
+                        std::lock_guard<std::mutex> lock(getFolderMutex());
+                        AllInfoIn.set(I,ConstPropInfo::ConstVal(ConstPropInfo::Const,Folder.CreateBinOp(binOp->getOpcode(),x_const,y_const)));
+                    }else{
+                        AllInfoIn.set(I,ConstPropInfo::ConstVal(ConstPropInfo::Top,nullptr));
+                    }
+                }
+                //Flowfunction for unary operator
+                else if(UnaryOperator* unaOp=dyn_cast<UnaryOperator>(I)){
+                    Value* x=I->getOperand(0);
+                    Constant* x_const=dyn_cast<Constant>(x);
+                    if(!x_const){
+                        ConstPropInfo::ConstVal x_val=AllInfoIn.get(x);
+                        if(x_val.state==ConstPropInfo::Const)
+                            x_const=x_val.value;
+                    }
+                    if(x_const){
+                        std::lock_guard<std::mutex> lock(getFolderMutex());
+                        AllInfoIn.set(I,ConstPropInfo::ConstVal(ConstPropInfo::Const,Folder.CreateUnOp(unaOp->getOpcode(),x_const)));
+                    }else{
+                        AllInfoIn.set(I,ConstPropInfo::ConstVal(ConstPropInfo::Top,nullptr));
+                    }
+                }
+                //Flowfunction for compare operator
+                else if(CmpInst* cmpOp=dyn_cast<CmpInst>(I)){
+                    Value* x=I->getOperand(0);
+                    Value* y=I->getOperand(1);
+                    Constant* x_const=dyn_cast<Constant>(x);
+                    Constant* y_const=dyn_cast<Constant>(y);
+                    if(!x_const){
+                        ConstPropInfo::ConstVal x_val=AllInfoIn.get(x);
+                        if(x_val.state==ConstPropInfo::Const)
+                            x_const=x_val.value;
+                    }
+                    if(!y_const){
+                        ConstPropInfo::ConstVal y_val=AllInfoIn.get(y);
+                        if(y_val.state==ConstPropInfo::Const)
+                            y_const=y_val.value;
+                    }
+                    if(x_const && y_const){
+                        std::lock_guard<std::mutex> lock(getFolderMutex());
+                        if(isa<ICmpInst>(cmpOp))
+                            AllInfoIn.set(I,ConstPropInfo::ConstVal(ConstPropInfo::Const,Folder.CreateICmp(cmpOp->getPredicate(),x_const,y_const)));
+                        else
+                            AllInfoIn.set(I,ConstPropInfo::ConstVal(ConstPropInfo::Const,Folder.CreateFCmp(cmpOp->getPredicate(),x_const,y_const)));
+                    }else{
+                        AllInfoIn.set(I,ConstPropInfo::ConstVal(ConstPropInfo::Top,nullptr));
+                    }
+                }
+                //Flowfunction for select operator
+                else if(SelectInst* selOp=dyn_cast<SelectInst>(I)){
+                    Value* x=I->getOperand(0);
+                    Value* y=I->getOperand(1);
+                    Constant* x_const=dyn_cast<Constant>(x);
+                    Constant* y_const=dyn_cast<Constant>(y);
+                    if(!x_const){
+                        ConstPropInfo::ConstVal x_val=AllInfoIn.get(x);
+                        if(x_val.state==ConstPropInfo::Const)
+                            x_const=x_val.value;
+                    }
+                    if(!y_const){
+                        ConstPropInfo::ConstVal y_val=AllInfoIn.get(y);
+                        if(y_val.state==ConstPropInfo::Const)
+                            y_const=y_val.value;
+                    }
+                    if(x_const && y_const){
+                        std::lock_guard<std::mutex> lock(getFolderMutex());
+                        if(Constant* condition=dyn_cast<Constant>(selOp->getCondition()))
+                            AllInfoIn.set(I,ConstPropInfo::ConstVal(ConstPropInfo::Const,Folder.CreateSelect(condition,x_const,y_const)));
+                    }else{
+                        AllInfoIn.set(I,ConstPropInfo::ConstVal(ConstPropInfo::Top,nullptr));
+                    }
+                }
+                //Flowfunction for call instruction
+                else if(CallInst* callOp=dyn_cast<CallInst>(I)){
+                    if(const BitVector* mod=Mod.getModifiedGlobals(callOp->getCalledFunction())){   //Mod is shared by the threads, only read it
+                        for(unsigned globId: mod->set_bits()){
+                            AllInfoIn.set(Mod.getGlobal(globId),ConstPropInfo::ConstVal(ConstPropInfo::Top,nullptr));
+                        }
+                    }
+                }
+                //Flowfunction for load instruction
+                else if(LoadInst* loadOp=dyn_cast<LoadInst>(I)){
+                    if(!I->getType()->isPointerTy()){
+                        AllInfoIn.set(I,AllInfoIn.get(loadOp->getPointerOperand()));
+                    }else{
+                        AllInfoIn.set(I,ConstPropInfo::ConstVal(ConstPropInfo::Top,nullptr));
+                    }
+                }
+                //Flowfunction for store instruction
+                else if(StoreInst* storeOp=dyn_cast<StoreInst>(I)){
+                    Value* src=storeOp->getValueOperand();
+                    Value* dst=storeOp->getPointerOperand();
+                    if(Constant* srcVal=dyn_cast<Constant>(src)){
+                        AllInfoIn.set(dst,ConstPropInfo::ConstVal(ConstPropInfo::Const,srcVal));
+                    }else{
+                        if(!src->getType()->isPointerTy()){
+                            AllInfoIn.set(dst,AllInfoIn.get(src));
+                        }
+                    }
+                }
+                //Flowfunction for Phi instruction
+                else if(isa<PHINode>(I)){
+                    unsigned nonPhiIndex=InstrToIndex[I->getParent()->getFirstNonPHI()];
+                    for(unsigned i=curNodeIndex;i<nonPhiIndex;i++){
+                        PHINode* phiNode=dyn_cast<PHINode>(IndexToInstr[i]);
+                        unsigned phiOperandNum=phiNode->getNumIncomingValues();
+                        ConstPropInfo::ConstVal prevConstVal;
+                        if(isa<Constant>(phiNode->getIncomingValue(0))){
+                            prevConstVal.state=ConstPropInfo::Const;
+                            prevConstVal.value=dyn_cast<Constant>(phiNode->getIncomingValue(0));
+                        }else{
+                            prevConstVal.state=ConstPropInfo::Top;
+                            prevConstVal.value=nullptr;
+                        }
+                        bool sameFlag=true;
+                        for(unsigned j=1;j<phiOperandNum;j++){
+                            if(Value* val=dyn_cast<Constant>(phiNode->getIncomingValue(j))){
+                                if(val!=prevConstVal.value){
+                                    sameFlag=false;
+                                    break;
+                                }
+                            }else{
+                                sameFlag=false;
+                                break;
+                            }
+                        }
+                        if(sameFlag){
+                            AllInfoIn.set(IndexToInstr[i],prevConstVal);
+                        }else{
+                            AllInfoIn.set(IndexToInstr[i],ConstPropInfo::ConstVal(ConstPropInfo::Top,nullptr));
+                        }
+                    }
+                }
+                
+                for(unsigned i=0;i<InfoOut.size();++i){
+                    *InfoOut[i]=AllInfoIn;
+                }
+            }
+        public:
+            //the constructor which explicitly call the constructor of parent class
+            ConstPropAnalysis(ConstPropInfo& bottom, ConstPropInfo& initialState, const GlobalModSummary& mod):DataFlowAnalysis(bottom,initialState),Mod(mod){
+                std::shared_ptr<ConstPropInfo::ConstMap::Factory> factory=std::make_shared<ConstPropInfo::ConstMap::Factory>(false);
+                Bottom.setFactory(factory);
+                InitialState.setFactory(factory);
+            }
+
+    };
+
+} // namespace llvm
+
+#endif
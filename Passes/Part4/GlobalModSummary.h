@@ -0,0 +1,245 @@
+//===- GlobalModSummary.h - Per-function modified globals ----------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file provides the MOD summary of the CSE 231 constant propagation:
+// the set of global variables each function may modify, stored as bit vectors
+// over a dense numbering of the globals of the module.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_231GLOBALMODSUMMARY_H
+#define LLVM_TRANSFORMS_231GLOBALMODSUMMARY_H
+
+#include "SteensgaardPointsTo.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Analysis/CallGraph.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/TimeProfiler.h"
+#include <string>
+#include <vector>
+
+namespace llvm {
+
+/*
+ * Global variables are numbered densely in module order, and functions get a
+ * slot each, so a MOD set is a BitVector indexed by global id and merging two
+ * of them is a word-wise OR.
+ * Slot 0 belongs to the null function, which stands for the callers and
+ * callees the call graph cannot name (its external nodes and indirect calls).
+ * Once built the summary is only read, so threads may query it concurrently.
+ * While it is built, mergeSCC may run concurrently on SCCs that do not call
+ * each other, see runOnCallGraphInParallel.
+ */
+class GlobalModSummary {
+  public:
+    GlobalModSummary() = default;
+    GlobalModSummary(const GlobalModSummary &) = delete;
+    GlobalModSummary &operator=(const GlobalModSummary &) = delete;
+    GlobalModSummary(GlobalModSummary &&) = default;
+    GlobalModSummary &operator=(GlobalModSummary &&) = default;
+
+    /*
+     * Number the globals and functions of M and start every MOD set empty.
+     * Any previous content is dropped.
+     */
+    void init(Module &M) {
+      Globals.clear();
+      GlobalIds.clear();
+      FunctionIds.clear();
+      for (GlobalVariable &glob : M.globals()) {
+        GlobalIds[&glob] = Globals.size();
+        Globals.push_back(&glob);
+      }
+      FunctionIds[nullptr] = 0;
+      for (Function &func : M.functions())
+        FunctionIds.insert(std::make_pair(&func, FunctionIds.size()));
+      Mod.assign(FunctionIds.size(), BitVector(Globals.size()));
+    }
+
+    unsigned getNumGlobals() const { return Globals.size(); }
+
+    GlobalVariable *getGlobal(unsigned id) const { return Globals[id]; }
+
+    /*
+     * Id of a global, or -1 if it is not a global of the module.
+     */
+    int getGlobalId(const Value *v) const {
+      auto it = GlobalIds.find(dyn_cast<GlobalVariable>(v));
+      return it == GlobalIds.end() ? -1 : (int)it->second;
+    }
+
+    /*
+     * An empty set of globals, to build GlobMPT-like sets with.
+     */
+    BitVector makeGlobalSet() const { return BitVector(Globals.size()); }
+
+    /*
+     * The globals F may modify, indexed by global id, or nullptr if F is not
+     * a function of the module.
+     */
+    const BitVector *getModifiedGlobals(const Function *F) const {
+      auto it = FunctionIds.find(F);
+      return it == FunctionIds.end() ? nullptr : &Mod[it->second];
+    }
+
+    bool mayModify(const Function *F, const GlobalVariable *glob) const {
+      const BitVector *mod = getModifiedGlobals(F);
+      int id = getGlobalId(glob);
+      return mod && id >= 0 && mod->test(id);
+    }
+
+    /*
+     * Mutable access for the passes that build the summary.
+     */
+    BitVector &getMod(const Function *F) { return Mod[FunctionIds.lookup(F)]; }
+
+    void addModified(const Function *F, unsigned globalId) { getMod(F).set(globalId); }
+
+    void addModified(const Function *F, const BitVector &globals) { getMod(F) |= globals; }
+
+    /*
+     * How computeLocal finds the globals a store through a pointer may modify:
+     *   SyntacticMPT:  every global whose address is taken (MPT), for a store
+     *                  through a pointer to pointer
+     *   SteensgaardMPT: the globals in the class the pointer points to, as
+     *                  SteensgaardPointsTo computes it, for any store through a pointer
+     */
+    enum MPTKind { SyntacticMPT, SteensgaardMPT };
+
+    /*
+     * init(M), then the globals each function modifies itself (LMOD): the ones
+     * it stores to, and those it may modify through pointers, as Kind finds them.
+     */
+    void computeLocal(Module &M, MPTKind Kind = SyntacticMPT) {
+      init(M);
+      if (Kind == SteensgaardMPT) {
+        computeLocalSteensgaard(M);
+        return;
+      }
+
+      //********************MPT Analysis***********************
+      //Only the globals of MPT are used, so they are collected directly into the GlobMPT bitset
+      BitVector GlobMPT = makeGlobalSet();
+      {   //the scope of the MPT trace event
+        TimeTraceScope traceScope("CSE231MPT");
+        auto insertMPT = [this, &GlobMPT](Value *var) {
+          int globId = getGlobalId(var);
+          if (globId >= 0)
+            GlobMPT.set(globId);
+        };
+        //global variable initialization reference
+        for (GlobalVariable &variable : M.globals()) {
+          if (variable.hasInitializer() && isa<GlobalVariable>(variable.getInitializer()))
+            insertMPT(variable.getInitializer());
+        }
+        //local variable, function parameter and return value
+        for (Function &func : M.functions()) {
+          for (BasicBlock &block : func) {
+            for (Instruction &instr : block) {
+              if (StoreInst *store = dyn_cast<StoreInst>(&instr)) {   // local variable initialization reference
+                if (false == isa<Constant>(store->getValueOperand()))
+                  insertMPT(store->getValueOperand());
+              } else if (isa<CallInst>(instr) || isa<ReturnInst>(instr)) {
+                for (Use &operand : instr.operands())
+                  insertMPT(operand);   // reference parameters in function call, and return value reference
+              }
+            }
+          }
+        }
+      }
+
+      //********************LMOD Analysis***********************
+      TimeTraceScope traceScope("CSE231LMOD");
+      for (Function &func : M.functions()) {
+        for (BasicBlock &block : func) {
+          for (Instruction &instr : block) {
+            if (StoreInst *store = dyn_cast<StoreInst>(&instr)) {
+              Value *dstVal = store->getPointerOperand();
+              int globId = getGlobalId(dstVal);
+              if (globId >= 0)
+                addModified(&func, globId);     //global variable is directly modified
+              else if (isPointerToPointer(dstVal))
+                addModified(&func, GlobMPT);    //dereference pointer is modified
+            }
+          }
+        }
+      }
+    }
+
+    /*
+     * Close one SCC of the call graph over its callees (CMOD): every function
+     * of the SCC gets the union of the sets of the SCC and of their callees.
+     * Called on the SCCs bottom-up after computeLocal, it makes the summary final.
+     * It only writes the sets of the SCC, and only reads those of the callees.
+     */
+    void mergeSCC(ArrayRef<CallGraphNode *> SCC) {
+      //********************CMOD Analysis***********************
+      TimeTraceScope traceScope("CSE231CMOD", [SCC]() {
+        std::string names;
+        for (CallGraphNode *node : SCC) {
+          if (Function *func = node->getFunction())
+            names += (names.empty() ? "" : ",") + func->getName().str();
+        }
+        return names;
+      });
+      BitVector tmpSet = makeGlobalSet();
+
+      for (CallGraphNode *callerNode : SCC) {
+        BitVector &callerMod = getMod(callerNode->getFunction());
+        for (auto &record : *callerNode) {   // get callee info outside current SCC (callee info inside current SCC is also involved, but doesn't matter)
+          if (const BitVector *calleeMod = getModifiedGlobals(record.second->getFunction()))
+            callerMod |= *calleeMod;
+        }
+        //union info of each caller function to solve the loop issue
+        tmpSet |= callerMod;
+      }
+
+      for (CallGraphNode *callerNode : SCC)
+        getMod(callerNode->getFunction()) = tmpSet;
+    }
+
+  private:
+    void computeLocalSteensgaard(Module &M) {
+      SteensgaardPointsTo PointsTo;
+      PointsTo.compute(M);
+      TimeTraceScope traceScope("CSE231LMOD");
+      for (Function &func : M.functions()) {
+        for (Instruction &instr : instructions(func)) {
+          if (StoreInst *store = dyn_cast<StoreInst>(&instr)) {
+            Value *dstVal = store->getPointerOperand();
+            int globId = getGlobalId(dstVal);
+            if (globId >= 0)
+              addModified(&func, globId);
+            else if (const BitVector *globs = PointsTo.getPointedGlobals(dstVal))
+              addModified(&func, *globs);
+          }
+        }
+      }
+    }
+
+    static bool isPointerToPointer(Value *v) {
+      Type *t = v->getType();
+      return t->isPointerTy() && t->getContainedType(0)->isPointerTy();
+    }
+
+    std::vector<GlobalVariable *> Globals;
+    DenseMap<const GlobalVariable *, unsigned> GlobalIds;
+    DenseMap<const Function *, unsigned> FunctionIds;
+    std::vector<BitVector> Mod;
+};
+
+} // namespace llvm
+
+#endif
@@ -0,0 +1,349 @@
+//===- SteensgaardPointsTo.h - Unification-based points-to analysis ------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file provides a whole-module, unification-based (Steensgaard style)
+// points-to analysis. It runs in almost linear time in the size of the module
+// and partitions pointers and memory into equivalence classes: two pointers
+// may alias if they point to the same class.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_231STEENSGAARDPOINTSTO_H
+#define LLVM_TRANSFORMS_231STEENSGAARDPOINTSTO_H
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/TimeProfiler.h"
+#include <utility>
+#include <vector>
+
+namespace llvm {
+
+/*
+ * Every value that may hold an address gets a node, and a node points to at
+ * most one node, the class of everything it may point to; an assignment
+ * unifies the targets of both sides, and unifying two nodes unifies their
+ * targets in turn (union-find with union by rank and path compression).
+ *
+ * Only values of pointer type are tracked, so addresses converted to integers
+ * are lost. The memory of an alloca or a global is the target of its value. Casts,
+ * getelementptr, select and phi are assignments from their pointer operands,
+ * and direct calls assign the arguments to the parameters and the returned
+ * values to the result. The pointer arguments and the results of calls to
+ * declarations and of indirect calls are all unified with one node standing
+ * for the code outside the module. So are the parameters and the returned
+ * values of the functions whose address is taken, which such calls may reach.
+ *
+ * Class ids are only comparable within one run of compute().
+ */
+class SteensgaardPointsTo {
+  public:
+    //A pointer of the may-point-to analysis: ('R', index) or ('M', index), see MayPointToAnalysis.h
+    typedef std::pair<char, unsigned> PtrID;
+
+    SteensgaardPointsTo() = default;
+    SteensgaardPointsTo(const SteensgaardPointsTo &) = delete;
+    SteensgaardPointsTo &operator=(const SteensgaardPointsTo &) = delete;
+    SteensgaardPointsTo(SteensgaardPointsTo &&) = default;
+    SteensgaardPointsTo &operator=(SteensgaardPointsTo &&) = default;
+
+    /*
+     * Analyze M. Any previous result is dropped.
+     */
+    void compute(Module &M) {
+      TimeTraceScope traceScope("CSE231Steensgaard");
+      Parent.clear();
+      Rank.clear();
+      Pointee.clear();
+      ValueNodes.clear();
+      ReturnNodes.clear();
+      FunctionInstrs.clear();
+      ClassGlobals.clear();
+      Globals.clear();
+      External = newNode();
+
+      for (GlobalVariable &glob : M.globals()) {
+        Globals.push_back(&glob);
+        getPointee(getNode(&glob));     //the memory of the global
+      }
+      for (GlobalVariable &glob : M.globals()) {
+        if (glob.hasInitializer())
+          addStore(&glob, glob.getInitializer());
+      }
+      for (Function &func : M) {
+        std::vector<Instruction *> &instrs = FunctionInstrs[&func];
+        instrs.push_back(nullptr);      //index 0 is the dummy node of assignIndiceToInstrs
+        for (Instruction &instr : instructions(func)) {
+          instrs.push_back(&instr);
+          addInstruction(instr);
+        }
+        if (!func.isDeclaration() && func.hasAddressTaken())
+          addAddressTaken(func);
+      }
+
+      //flatten the forest so that the queries need no path compression
+      for (unsigned node = 0; node < Parent.size(); ++node)
+        Parent[node] = find(node);
+      for (unsigned id = 0; id < Globals.size(); ++id) {
+        BitVector &globs = ClassGlobals[getGlobalClass(Globals[id])];
+        globs.resize(Globals.size());
+        globs.set(id);
+      }
+    }
+
+    /*
+     * The class of the pointer V itself, or -1 if V holds no address the
+     * analysis has seen.
+     */
+    int getClass(const Value *V) const {
+      auto it = ValueNodes.find(getBase(V));
+      return it == ValueNodes.end() ? -1 : (int)Parent[it->second];
+    }
+
+    /*
+     * The class of what V may point to, or -1 if it points to nothing known.
+     */
+    int getPointeeClass(const Value *V) const {
+      int cls = getClass(V);
+      if (cls < 0 || Pointee[cls] == None)
+        return -1;
+      return Parent[Pointee[cls]];
+    }
+
+    /*
+     * The class of a PtrID of F: the value of the instruction for 'R', its
+     * memory for 'M'. -1 if there is none.
+     */
+    int getClass(const Function *F, PtrID p) const {
+      auto it = FunctionInstrs.find(F);
+      if (it == FunctionInstrs.end() || p.second == 0 || p.second >= it->second.size())
+        return -1;
+      const Instruction *instr = it->second[p.second];
+      return p.first == 'M' ? getPointeeClass(instr) : getClass(instr);
+    }
+
+    /*
+     * The class of the memory of a global.
+     */
+    int getGlobalClass(const GlobalVariable *G) const { return getPointeeClass(G); }
+
+    bool mayAlias(const Value *V1, const Value *V2) const {
+      int cls = getPointeeClass(V1);
+      return cls >= 0 && cls == getPointeeClass(V2);
+    }
+
+    /*
+     * The globals, by index in module order, whose memory Ptr may point to,
+     * or nullptr if none.
+     */
+    const BitVector *getPointedGlobals(const Value *Ptr) const {
+      auto it = ClassGlobals.find(getPointeeClass(Ptr));
+      return it == ClassGlobals.end() ? nullptr : &it->second;
+    }
+
+    unsigned getNumNodes() const { return Parent.size(); }
+
+  private:
+    enum : unsigned { None = ~0u };
+
+    unsigned newNode() {
+      Parent.push_back(Parent.size());
+      Rank.push_back(0);
+      Pointee.push_back(None);
+      return Parent.size() - 1;
+    }
+
+    unsigned find(unsigned node) {
+      while (Parent[node] != node) {
+        Parent[node] = Parent[Parent[node]];
+        node = Parent[node];
+      }
+      return node;
+    }
+
+    /*
+     * Constant expressions that compute an address stand for the global they
+     * are based on.
+     */
+    static const Value *getBase(const Value *V) {
+      while (const ConstantExpr *expr = dyn_cast<ConstantExpr>(V)) {
+        if (!expr->isCast() && expr->getOpcode() != Instruction::GetElementPtr)
+          break;
+        V = expr->getOperand(0);
+      }
+      return V;
+    }
+
+    /*
+     * The node of V, created on first use, or None for the values that hold
+     * no address: the ones not of pointer type, and constants other than
+     * globals and functions.
+     */
+    unsigned getNode(const Value *V) {
+      V = getBase(V);
+      if (!V->getType()->isPointerTy() || (isa<Constant>(V) && !isa<GlobalValue>(V)))
+        return None;
+      auto it = ValueNodes.find(V);
+      if (it != ValueNodes.end())
+        return it->second;
+      unsigned node = newNode();
+      ValueNodes[V] = node;
+      return node;
+    }
+
+    unsigned getPointee(unsigned node) {
+      node = find(node);
+      if (Pointee[node] == None) {
+        unsigned target = newNode();
+        Pointee[node] = target;
+      }
+      return Pointee[node];
+    }
+
+    void unify(unsigned a, unsigned b) {
+      SmallVector<std::pair<unsigned, unsigned>, 8> pending;
+      pending.push_back(std::make_pair(a, b));
+      while (!pending.empty()) {
+        a = find(pending.back().first);
+        b = find(pending.back().second);
+        pending.pop_back();
+        if (a == b)
+          continue;
+        if (Rank[a] < Rank[b])
+          std::swap(a, b);
+        if (Rank[a] == Rank[b])
+          Rank[a]++;
+        Parent[b] = a;
+        if (Pointee[a] == None)
+          Pointee[a] = Pointee[b];
+        else if (Pointee[b] != None)
+          pending.push_back(std::make_pair(Pointee[a], Pointee[b]));
+      }
+    }
+
+    //dst = src
+    void addAssign(const Value *dst, const Value *src) {
+      unsigned dstNode = getNode(dst), srcNode = getNode(src);
+      if (dstNode != None && srcNode != None)
+        unify(getPointee(dstNode), getPointee(srcNode));
+    }
+
+    //dst = *ptr
+    void addLoad(const Value *dst, const Value *ptr) {
+      unsigned dstNode = getNode(dst), ptrNode = getNode(ptr);
+      if (dstNode != None && ptrNode != None)
+        unify(getPointee(dstNode), getPointee(getPointee(ptrNode)));
+    }
+
+    //*ptr = src
+    void addStore(const Value *ptr, const Value *src) {
+      unsigned ptrNode = getNode(ptr), srcNode = getNode(src);
+      if (ptrNode != None && srcNode != None)
+        unify(getPointee(getPointee(ptrNode)), getPointee(srcNode));
+    }
+
+    unsigned getReturnNode(const Function *F) {
+      auto it = ReturnNodes.find(F);
+      if (it != ReturnNodes.end())
+        return it->second;
+      unsigned node = newNode();
+      ReturnNodes[F] = node;
+      return node;
+    }
+
+    void addInstruction(Instruction &instr) {
+      if (isa<AllocaInst>(instr)) {
+        getPointee(getNode(&instr));    //the memory of the alloca
+      } else if (LoadInst *load = dyn_cast<LoadInst>(&instr)) {
+        addLoad(load, load->getPointerOperand());
+      } else if (StoreInst *store = dyn_cast<StoreInst>(&instr)) {
+        addStore(store->getPointerOperand(), store->getValueOperand());
+      } else if (AtomicCmpXchgInst *cmpxchg = dyn_cast<AtomicCmpXchgInst>(&instr)) {
+        addStore(cmpxchg->getPointerOperand(), cmpxchg->getNewValOperand());
+      } else if (AtomicRMWInst *rmw = dyn_cast<AtomicRMWInst>(&instr)) {
+        addStore(rmw->getPointerOperand(), rmw->getValOperand());
+        addLoad(rmw, rmw->getPointerOperand());
+      } else if (isa<CastInst>(instr)) {
+        addAssign(&instr, instr.getOperand(0));
+      } else if (GetElementPtrInst *gep = dyn_cast<GetElementPtrInst>(&instr)) {
+        addAssign(gep, gep->getPointerOperand());
+      } else if (SelectInst *select = dyn_cast<SelectInst>(&instr)) {
+        addAssign(select, select->getTrueValue());
+        addAssign(select, select->getFalseValue());
+      } else if (PHINode *phi = dyn_cast<PHINode>(&instr)) {
+        for (Value *incoming : phi->incoming_values())
+          addAssign(phi, incoming);
+      } else if (ReturnInst *ret = dyn_cast<ReturnInst>(&instr)) {
+        if (Value *val = ret->getReturnValue()) {
+          unsigned valNode = getNode(val);
+          if (valNode != None)
+            unify(getPointee(getReturnNode(ret->getFunction())), getPointee(valNode));
+        }
+      } else if (CallBase *call = dyn_cast<CallBase>(&instr)) {
+        addCall(*call);
+      }
+    }
+
+    void addCall(CallBase &call) {
+      Function *callee = call.getCalledFunction();
+      if (callee && !callee->isDeclaration()) {
+        for (unsigned i = 0; i < call.arg_size() && i < callee->arg_size(); ++i)
+          addAssign(callee->getArg(i), call.getArgOperand(i));
+        unsigned callNode = getNode(&call);
+        if (callNode != None)
+          unify(getPointee(callNode), getPointee(getReturnNode(callee)));
+        return;
+      }
+      //anything passed outside the module may come back from any such call
+      for (Value *arg : call.args()) {
+        unsigned argNode = getNode(arg);
+        if (argNode != None)
+          unify(getPointee(External), getPointee(argNode));
+      }
+      unsigned callNode = getNode(&call);
+      if (callNode != None)
+        unify(getPointee(callNode), getPointee(External));
+    }
+
+    //the callers of an address-taken function may be indirect calls or code outside the module
+    void addAddressTaken(Function &func) {
+      for (Argument &arg : func.args()) {
+        unsigned argNode = getNode(&arg);
+        if (argNode != None)
+          unify(getPointee(External), getPointee(argNode));
+      }
+      if (func.getReturnType()->isPointerTy())
+        unify(getPointee(getReturnNode(&func)), getPointee(External));
+    }
+
+    // Union-find forest, and the target of each representative
+    std::vector<unsigned> Parent;
+    std::vector<unsigned> Rank;
+    std::vector<unsigned> Pointee;
+    DenseMap<const Value *, unsigned> ValueNodes;
+    DenseMap<const Function *, unsigned> ReturnNodes;
+    // The instructions of each function by index, as assignIndiceToInstrs numbers them
+    DenseMap<const Function *, std::vector<Instruction *>> FunctionInstrs;
+    // The globals whose memory is in each class
+    DenseMap<int, BitVector> ClassGlobals;
+    std::vector<GlobalVariable *> Globals;
+    // Stands for the code outside the module
+    unsigned External;
+};
+
+} // namespace llvm
+
+#endif
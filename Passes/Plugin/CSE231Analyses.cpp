@@ -0,0 +1,116 @@
+//===- CSE231Analyses.cpp - New pass manager CSE 231 analyses ------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the analyses and printer passes of CSE231Analyses.h.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CSE231Analyses.h"
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/Analysis/CallGraph.h"
+#include "llvm/Support/ErrorHandling.h"
+#include <set>
+#include <type_traits>
+#include <vector>
+
+using namespace llvm;
+
+AnalysisKey CSE231ReachingAnalysis::Key;
+AnalysisKey CSE231LivenessAnalysis::Key;
+AnalysisKey CSE231SSALivenessAnalysis::Key;
+AnalysisKey CSE231MayPointToAnalysis::Key;
+AnalysisKey CSE231ModAnalysis::Key;
+AnalysisKey CSE231ConstPropAnalysis::Key;
+
+// Solve F with a freshly constructed AnalysisT, as the legacy passes do
+template <class AnalysisT, class InfoT>
+static std::unique_ptr<AnalysisT> solve(Function &F, StringRef Name, InfoT &Bottom, InfoT &InitialState) {
+  std::unique_ptr<AnalysisT> Analysis = std::make_unique<AnalysisT>(Bottom, InitialState);
+  Analysis->setBlockGranularity(DFABlockGranularity);
+  Analysis->runWorklistAlgorithm(&F);
+  reportSolverStats(Name, F, Analysis->getSolverStats());
+  return Analysis;
+}
+
+CSE231ReachingAnalysis::Result CSE231ReachingAnalysis::run(Function &F, FunctionAnalysisManager &) {
+  ReachingInfo Bottom, InitialState;
+  return solve<ReachingDefinitionAnalysis>(F, "reaching", Bottom, InitialState);
+}
+
+CSE231LivenessAnalysis::Result CSE231LivenessAnalysis::run(Function &F, FunctionAnalysisManager &) {
+  LivenessInfo Bottom, InitialState;
+  return solve<LivenessAnalysis>(F, "liveness", Bottom, InitialState);
+}
+
+CSE231SSALivenessAnalysis::Result CSE231SSALivenessAnalysis::run(Function &F, FunctionAnalysisManager &) {
+  Result Liveness = std::make_unique<SSALiveness>();
+  Liveness->compute(&F);
+  return Liveness;
+}
+
+CSE231MayPointToAnalysis::Result CSE231MayPointToAnalysis::run(Function &F, FunctionAnalysisManager &) {
+  MayPointToInfo Bottom, InitialState;
+  return solve<MayPointToDefinitionAnalysis>(F, "maypointto", Bottom, InitialState);
+}
+
+CSE231ModAnalysis::Result CSE231ModAnalysis::run(Module &M, ModuleAnalysisManager &MAM) {
+  GlobalModSummary Summary;
+  Summary.computeLocal(M);
+  // scc_iterator visits the SCCs bottom-up, as the legacy CallGraphSCCPass does
+  CallGraph &CG = MAM.getResult<CallGraphAnalysis>(M);
+  for (scc_iterator<CallGraph *> I = scc_begin(&CG); !I.isAtEnd(); ++I)
+    Summary.mergeSCC(*I);
+  return Summary;
+}
+
+CSE231ConstPropAnalysis::Result CSE231ConstPropAnalysis::run(Function &F, FunctionAnalysisManager &FAM) {
+  Module &M = *F.getParent();
+  auto &MAMProxy = FAM.getResult<ModuleAnalysisManagerFunctionProxy>(F);
+  const GlobalModSummary *Mod = MAMProxy.getCachedResult<CSE231ModAnalysis>(M);
+  if (!Mod)
+    report_fatal_error("cse231-constprop needs the MOD summary of the module, run require<cse231-mod> first");
+  MAMProxy.registerOuterAnalysisInvalidation<CSE231ModAnalysis, CSE231ConstPropAnalysis>();
+
+  std::set<GlobalVariable *> Globals;
+  for (GlobalVariable &G : M.globals())
+    Globals.insert(&G);
+  ConstPropInfo Bottom(ConstPropInfo::ConstVal(ConstPropInfo::Bottom, nullptr), Globals);
+  ConstPropInfo InitialState(ConstPropInfo::ConstVal(ConstPropInfo::Top, nullptr), Globals);
+  Result Analysis = std::make_unique<ConstPropAnalysis>(Bottom, InitialState, *Mod);
+  Analysis->setBlockGranularity(DFABlockGranularity);
+  Analysis->runWorklistAlgorithm(&F);
+  reportSolverStats("constprop", F, Analysis->getSolverStats());
+  return Analysis;
+}
+
+template <class AnalysisT>
+PreservedAnalyses CSE231PrinterPass<AnalysisT>::run(Module &M, ModuleAnalysisManager &MAM) {
+  if (std::is_same<AnalysisT, CSE231ConstPropAnalysis>::value)
+    MAM.getResult<CSE231ModAnalysis>(M);
+  FunctionAnalysisManager &FAM = MAM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+
+  // The analysis managers are not thread safe, so the functions are solved
+  // here and only the printing runs on the threads, from the cached results
+  for (Function &F : M) {
+    if (!F.isDeclaration())
+      FAM.getResult<AnalysisT>(F);
+  }
+  runOnFunctionsInParallel(M, [&FAM](Function &F, raw_ostream &OS) {
+    (*FAM.getCachedResult<AnalysisT>(F))->print(OS);
+  }, errs());
+  return PreservedAnalyses::all();
+}
+
+namespace llvm {
+template class CSE231PrinterPass<CSE231ReachingAnalysis>;
+template class CSE231PrinterPass<CSE231LivenessAnalysis>;
+template class CSE231PrinterPass<CSE231SSALivenessAnalysis>;
+template class CSE231PrinterPass<CSE231MayPointToAnalysis>;
+template class CSE231PrinterPass<CSE231ConstPropAnalysis>;
+} // namespace llvm
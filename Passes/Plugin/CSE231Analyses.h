@@ -0,0 +1,129 @@
+//===- CSE231Analyses.h - New pass manager CSE 231 analyses --------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file provides the CSE 231 analyses as analyses of the new pass manager,
+// so that passes can share one solve of a function through the analysis
+// managers, and the printer passes that print them as the legacy passes do.
+//
+// A result is the solved dataflow analysis; query it with getInfo() and the
+// index mapping of DataFlowAnalysis. Results are cached until the function is
+// changed, or for const-prop, until the MOD summary of the module is.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_231ANALYSES_H
+#define LLVM_TRANSFORMS_231ANALYSES_H
+
+#include "ConstPropAnalysis.h"
+#include "GlobalModSummary.h"
+#include "LivenessAnalysis.h"
+#include "MayPointToAnalysis.h"
+#include "ReachingDefinitionAnalysis.h"
+#include "SSALiveness.h"
+#include "llvm/IR/PassManager.h"
+#include <memory>
+
+namespace llvm {
+
+/*
+ * Reaching definitions of a function.
+ */
+class CSE231ReachingAnalysis : public AnalysisInfoMixin<CSE231ReachingAnalysis> {
+  friend AnalysisInfoMixin<CSE231ReachingAnalysis>;
+  static AnalysisKey Key;
+
+  public:
+    typedef std::unique_ptr<ReachingDefinitionAnalysis> Result;
+    Result run(Function &F, FunctionAnalysisManager &FAM);
+};
+
+/*
+ * Live variables of a function.
+ */
+class CSE231LivenessAnalysis : public AnalysisInfoMixin<CSE231LivenessAnalysis> {
+  friend AnalysisInfoMixin<CSE231LivenessAnalysis>;
+  static AnalysisKey Key;
+
+  public:
+    typedef std::unique_ptr<LivenessAnalysis> Result;
+    Result run(Function &F, FunctionAnalysisManager &FAM);
+};
+
+/*
+ * Live variables of a function from its def-use chains, without a dataflow
+ * solve (the same sets as CSE231LivenessAnalysis).
+ */
+class CSE231SSALivenessAnalysis : public AnalysisInfoMixin<CSE231SSALivenessAnalysis> {
+  friend AnalysisInfoMixin<CSE231SSALivenessAnalysis>;
+  static AnalysisKey Key;
+
+  public:
+    typedef std::unique_ptr<SSALiveness> Result;
+    Result run(Function &F, FunctionAnalysisManager &FAM);
+};
+
+/*
+ * May-point-to sets of a function.
+ */
+class CSE231MayPointToAnalysis : public AnalysisInfoMixin<CSE231MayPointToAnalysis> {
+  friend AnalysisInfoMixin<CSE231MayPointToAnalysis>;
+  static AnalysisKey Key;
+
+  public:
+    typedef std::unique_ptr<MayPointToDefinitionAnalysis> Result;
+    Result run(Function &F, FunctionAnalysisManager &FAM);
+};
+
+/*
+ * The globals each function of the module may modify, closed over the call
+ * graph.
+ */
+class CSE231ModAnalysis : public AnalysisInfoMixin<CSE231ModAnalysis> {
+  friend AnalysisInfoMixin<CSE231ModAnalysis>;
+  static AnalysisKey Key;
+
+  public:
+    typedef GlobalModSummary Result;
+    Result run(Module &M, ModuleAnalysisManager &MAM);
+};
+
+/*
+ * Constant propagation of a function. Needs the cached CSE231ModAnalysis of
+ * its module (compute it first, e.g. with require<cse231-mod>), and is
+ * invalidated with it.
+ */
+class CSE231ConstPropAnalysis : public AnalysisInfoMixin<CSE231ConstPropAnalysis> {
+  friend AnalysisInfoMixin<CSE231ConstPropAnalysis>;
+  static AnalysisKey Key;
+
+  public:
+    typedef std::unique_ptr<ConstPropAnalysis> Result;
+    Result run(Function &F, FunctionAnalysisManager &FAM);
+};
+
+/*
+ * Print the results of AnalysisT for every function of the module, in the
+ * format and to the destination of the legacy pass (-cse231-output-format,
+ * -cse231-output). Results already cached are reused.
+ */
+template <class AnalysisT>
+class CSE231PrinterPass : public PassInfoMixin<CSE231PrinterPass<AnalysisT>> {
+  public:
+    PreservedAnalyses run(Module &M, ModuleAnalysisManager &MAM);
+};
+
+typedef CSE231PrinterPass<CSE231ReachingAnalysis> CSE231ReachingPrinterPass;
+typedef CSE231PrinterPass<CSE231LivenessAnalysis> CSE231LivenessPrinterPass;
+typedef CSE231PrinterPass<CSE231SSALivenessAnalysis> CSE231SSALivenessPrinterPass;
+typedef CSE231PrinterPass<CSE231MayPointToAnalysis> CSE231MayPointToPrinterPass;
+typedef CSE231PrinterPass<CSE231ConstPropAnalysis> CSE231ConstPropPrinterPass;
+
+} // namespace llvm
+
+#endif
@@ -0,0 +1,91 @@
+//===- CSE231Plugin.cpp - New pass manager plugin of the CSE 231 passes --===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file registers the analyses of CSE231Analyses.h with the new pass
+// manager. Load it with opt -load-pass-plugin and use
+//
+//   -passes=cse231-reaching, cse231-liveness, cse231-ssa-liveness, cse231-maypointto,
+//           cse231-constprop
+//       to print the results as the legacy passes do;
+//   require<cse231-reaching>, require<cse231-liveness>, require<cse231-ssa-liveness>,
+//   require<cse231-maypointto>, require<cse231-constprop> (function passes),
+//   require<cse231-mod> (module pass)
+//       and the matching invalidate<...> to compute or drop cached results.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CSE231Analyses.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Passes/PassPlugin.h"
+
+using namespace llvm;
+
+// Add require<Name> or invalidate<Name> of AnalysisT to PM if Name is one of them
+template <class AnalysisT, class IRUnitT>
+static bool parseAnalysisPass(StringRef Name, StringRef AnalysisName, PassManager<IRUnitT> &PM) {
+  if (Name == ("require<" + AnalysisName + ">").str()) {
+    PM.addPass(RequireAnalysisPass<AnalysisT, IRUnitT>());
+    return true;
+  }
+  if (Name == ("invalidate<" + AnalysisName + ">").str()) {
+    PM.addPass(InvalidateAnalysisPass<AnalysisT>());
+    return true;
+  }
+  return false;
+}
+
+static void registerCSE231Passes(PassBuilder &PB) {
+  PB.registerAnalysisRegistrationCallback([](FunctionAnalysisManager &FAM) {
+    FAM.registerPass([] { return CSE231ReachingAnalysis(); });
+    FAM.registerPass([] { return CSE231LivenessAnalysis(); });
+    FAM.registerPass([] { return CSE231SSALivenessAnalysis(); });
+    FAM.registerPass([] { return CSE231MayPointToAnalysis(); });
+    FAM.registerPass([] { return CSE231ConstPropAnalysis(); });
+  });
+  PB.registerAnalysisRegistrationCallback([](ModuleAnalysisManager &MAM) {
+    MAM.registerPass([] { return CSE231ModAnalysis(); });
+  });
+
+  PB.registerPipelineParsingCallback(
+      [](StringRef Name, ModulePassManager &MPM, ArrayRef<PassBuilder::PipelineElement>) {
+        if (Name == "cse231-reaching") {
+          MPM.addPass(CSE231ReachingPrinterPass());
+          return true;
+        }
+        if (Name == "cse231-liveness") {
+          MPM.addPass(CSE231LivenessPrinterPass());
+          return true;
+        }
+        if (Name == "cse231-ssa-liveness") {
+          MPM.addPass(CSE231SSALivenessPrinterPass());
+          return true;
+        }
+        if (Name == "cse231-maypointto") {
+          MPM.addPass(CSE231MayPointToPrinterPass());
+          return true;
+        }
+        if (Name == "cse231-constprop") {
+          MPM.addPass(CSE231ConstPropPrinterPass());
+          return true;
+        }
+        return parseAnalysisPass<CSE231ModAnalysis>(Name, "cse231-mod", MPM);
+      });
+  PB.registerPipelineParsingCallback(
+      [](StringRef Name, FunctionPassManager &FPM, ArrayRef<PassBuilder::PipelineElement>) {
+        return parseAnalysisPass<CSE231ReachingAnalysis>(Name, "cse231-reaching", FPM) ||
+               parseAnalysisPass<CSE231LivenessAnalysis>(Name, "cse231-liveness", FPM) ||
+               parseAnalysisPass<CSE231SSALivenessAnalysis>(Name, "cse231-ssa-liveness", FPM) ||
+               parseAnalysisPass<CSE231MayPointToAnalysis>(Name, "cse231-maypointto", FPM) ||
+               parseAnalysisPass<CSE231ConstPropAnalysis>(Name, "cse231-constprop", FPM);
+      });
+}
+
+extern "C" LLVM_ATTRIBUTE_WEAK PassPluginLibraryInfo llvmGetPassPluginInfo() {
+  return {LLVM_PLUGIN_API_VERSION, "CSE231Passes", LLVM_VERSION_STRING, registerCSE231Passes};
+}
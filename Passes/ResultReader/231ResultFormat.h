@@ -0,0 +1,204 @@
+//===- 231ResultFormat.h - Binary format of CSE 231 results --------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file describes the binary output of the CSE 231 dataflow analyses
+// (-cse231-output-format=binary) and provides its writer. It is shared by the
+// passes and the reader library.
+//
+// File     := Magic[8] Version:u32le Function*
+// Function := Size:varint Name:string Kind:u8 NumStrings:varint string*
+//             NumEdges:varint Edge*                   (Size counts what follows it)
+// Edge     := SrcDelta:svarint DstDelta:svarint Fact  (from the previous source, and from this source)
+// string   := Length:varint bytes
+//
+// Facts by kind:
+//   Text     := String:varint                         (a string id, the printed fact without "\n")
+//   IndexSet := u8 Encoding, then either
+//               List:   Count:varint FirstIndex:varint Delta:varint*
+//               Bitmap: NumBytes:varint bytes         (bit i of byte j is index 8 * j + i)
+//   PointsTo := NumKeys:varint (Ptr NumTargets:varint Ptr*)*, Ptr := Kind:u8 Index:varint
+//   ConstMap := NumEntries:varint (Name:varint State:u8 [Value:varint if ValueState])*
+//
+// Varints are LEB128, signed ones zigzag encoded first. The facts keep the
+// order of the text output, so the reader can print it back exactly.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_231RESULTFORMAT_H
+#define LLVM_TRANSFORMS_231RESULTFORMAT_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringRef.h"
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace llvm {
+namespace cse231result {
+
+static const char Magic[8] = {'C', '2', '3', '1', 'R', 'E', 'S', '\0'};
+static const uint32_t Version = 1;
+static const unsigned HeaderSize = sizeof(Magic) + sizeof(uint32_t);
+
+enum FactKind : uint8_t { TextFact = 0, IndexSetFact = 1, PointsToFact = 2, ConstMapFact = 3 };
+enum SetEncoding : uint8_t { ListEncoding = 0, BitmapEncoding = 1 };
+enum ConstState : uint8_t { BottomState = 0, ValueState = 1, TopState = 2 };
+
+inline void writeVarint(std::string &Out, uint64_t Value) {
+  do {
+    uint8_t Byte = Value & 0x7f;
+    Value >>= 7;
+    Out.push_back(char(Value ? Byte | 0x80 : Byte));
+  } while (Value);
+}
+
+inline void writeSignedVarint(std::string &Out, int64_t Value) {
+  writeVarint(Out, (uint64_t(Value) << 1) ^ uint64_t(Value >> 63));
+}
+
+inline void writeString(std::string &Out, StringRef Str) {
+  writeVarint(Out, Str.size());
+  Out.append(Str.data(), Str.size());
+}
+
+inline std::string getFileHeader() {
+  std::string Header(Magic, sizeof(Magic));
+  for (unsigned I = 0; I < 4; ++I)
+    Header.push_back(char((Version >> (8 * I)) & 0xff));
+  return Header;
+}
+
+/*
+ * Builds the record of one function. Facts are written after beginEdge,
+ * all of the same kind.
+ */
+class FunctionWriter {
+  public:
+    explicit FunctionWriter(StringRef Name) : Name(Name.str()) {}
+
+    void beginEdge(unsigned Src, unsigned Dst) {
+      writeSignedVarint(Edges, int64_t(Src) - int64_t(PrevSrc));
+      writeSignedVarint(Edges, int64_t(Dst) - int64_t(Src));
+      PrevSrc = Src;
+      ++NumEdges;
+    }
+
+    void writeText(StringRef Text) {
+      Kind = TextFact;
+      writeVarint(Edges, getStringId(Text.rtrim('\n')));
+    }
+
+    /*
+     * Indices must be ascending. The smaller of the two encodings is used.
+     */
+    void writeIndexSet(const std::vector<unsigned> &Indices) {
+      Kind = IndexSetFact;
+      std::string List;
+      writeVarint(List, Indices.size());
+      unsigned Prev = 0;
+      for (unsigned Index : Indices) {
+        writeVarint(List, Index - Prev);
+        Prev = Index;
+      }
+      size_t BitmapBytes = Indices.empty() ? 0 : Indices.back() / 8 + 1;
+      if (List.size() <= BitmapBytes + 1) {
+        Edges.push_back(char(ListEncoding));
+        Edges += List;
+        return;
+      }
+      Edges.push_back(char(BitmapEncoding));
+      writeVarint(Edges, BitmapBytes);
+      size_t Start = Edges.size();
+      Edges.resize(Start + BitmapBytes, '\0');
+      for (unsigned Index : Indices)
+        Edges[Start + Index / 8] |= char(1 << (Index % 8));
+    }
+
+    /*
+     * (kind, index) pointers, each key followed by its targets.
+     */
+    typedef std::pair<char, unsigned> Ptr;
+    void writePointsTo(const std::vector<std::pair<Ptr, std::vector<Ptr>>> &Map) {
+      Kind = PointsToFact;
+      writeVarint(Edges, Map.size());
+      for (auto &Entry : Map) {
+        writePtr(Entry.first);
+        writeVarint(Edges, Entry.second.size());
+        for (const Ptr &Target : Entry.second)
+          writePtr(Target);
+      }
+    }
+
+    /*
+     * Name, state and, for ValueState, the printed value of each variable.
+     */
+    struct ConstEntry {
+      std::string Name;
+      ConstState State;
+      std::string Value;
+    };
+    void writeConstMap(const std::vector<ConstEntry> &Entries) {
+      Kind = ConstMapFact;
+      writeVarint(Edges, Entries.size());
+      for (const ConstEntry &Entry : Entries) {
+        writeVarint(Edges, getStringId(Entry.Name));
+        Edges.push_back(char(Entry.State));
+        if (Entry.State == ValueState)
+          writeVarint(Edges, getStringId(Entry.Value));
+      }
+    }
+
+    /*
+     * The complete record, size prefix included.
+     */
+    std::string finish() const {
+      std::string Body;
+      writeString(Body, Name);
+      Body.push_back(char(Kind));
+      writeVarint(Body, Strings.size());
+      for (const std::string &Str : Strings)
+        writeString(Body, Str);
+      writeVarint(Body, NumEdges);
+      Body += Edges;
+      std::string Record;
+      writeVarint(Record, Body.size());
+      return Record + Body;
+    }
+
+  private:
+    void writePtr(const Ptr &P) {
+      Edges.push_back(P.first);
+      writeVarint(Edges, P.second);
+    }
+
+    unsigned getStringId(StringRef Str) {
+      auto It = StringIds.find(Str);
+      if (It != StringIds.end())
+        return It->second;
+      Strings.push_back(Str.str());
+      unsigned Id = Strings.size() - 1;
+      StringIds[StringRef(Strings.back())] = Id;
+      return Id;
+    }
+
+    std::string Name;
+    FactKind Kind = TextFact;
+    std::deque<std::string> Strings;                // a deque keeps the keys of StringIds in place
+    DenseMap<StringRef, unsigned> StringIds;
+    unsigned NumEdges = 0;
+    unsigned PrevSrc = 0;
+    std::string Edges;
+};
+
+} // namespace cse231result
+} // namespace llvm
+
+#endif
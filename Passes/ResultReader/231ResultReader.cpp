@@ -0,0 +1,224 @@
+//===- 231ResultReader.cpp - Reader of binary CSE 231 results ------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "231ResultReader.h"
+
+using namespace llvm;
+using namespace llvm::cse231result;
+
+namespace {
+
+// Bounds checked reads over a byte range. After a failed read every
+// following read fails too, so callers check once at the end.
+class Cursor {
+public:
+  explicit Cursor(StringRef Data) : Pos(Data.bytes_begin()), End(Data.bytes_end()) {}
+
+  bool failed() const { return Failed; }
+  void fail() { Failed = true; }
+  bool atEnd() const { return Pos == End; }
+
+  uint8_t readByte() {
+    if (Failed || Pos == End) {
+      Failed = true;
+      return 0;
+    }
+    return *Pos++;
+  }
+
+  uint64_t readVarint() {
+    uint64_t Value = 0;
+    for (unsigned Shift = 0; Shift < 64; Shift += 7) {
+      uint8_t Byte = readByte();
+      Value |= uint64_t(Byte & 0x7f) << Shift;
+      if (!(Byte & 0x80))
+        return Value;
+    }
+    Failed = true;
+    return 0;
+  }
+
+  int64_t readSignedVarint() {
+    uint64_t Value = readVarint();
+    return int64_t(Value >> 1) ^ -int64_t(Value & 1);
+  }
+
+  StringRef readBytes(uint64_t Size) {
+    if (Failed || uint64_t(End - Pos) < Size) {
+      Failed = true;
+      return StringRef();
+    }
+    StringRef Bytes(reinterpret_cast<const char *>(Pos), Size);
+    Pos += Size;
+    return Bytes;
+  }
+
+  StringRef readString() { return readBytes(readVarint()); }
+
+  StringRef readRest() { return readBytes(End - Pos); }
+
+  FunctionWriter::Ptr readPtr() {
+    char Kind = char(readByte());
+    return FunctionWriter::Ptr(Kind, unsigned(readVarint()));
+  }
+
+private:
+  const uint8_t *Pos;
+  const uint8_t *End;
+  bool Failed = false;
+};
+
+Error malformed(const Twine &What) {
+  return make_error<StringError>("malformed cse231 result: " + What, inconvertibleErrorCode());
+}
+
+} // namespace
+
+void Edge::print(raw_ostream &OS) const {
+  OS << "Edge " << Src << "->" "Edge " << Dst << ":";
+  if (!Text.empty())
+    OS << Text;
+  for (unsigned Index : Indices)
+    OS << Index << "|";
+  for (auto &Entry : PointsTo) {
+    OS << Entry.first.first << Entry.first.second << "->(";
+    for (auto &Target : Entry.second)
+      OS << Target.first << Target.second << '/';
+    OS << ")|";
+  }
+  for (const Const &Entry : Consts) {
+    OS << Entry.Name << "=";
+    if (Entry.State == BottomState)
+      OS << "⊥";
+    else if (Entry.State == TopState)
+      OS << "⊤";
+    else
+      OS << Entry.Value;
+    OS << "|";
+  }
+  OS << "\n";
+}
+
+Error FunctionRecord::forEachEdge(function_ref<void(const Edge &)> Callback) const {
+  Cursor C(EdgeData);
+  auto getString = [&](uint64_t Id) {
+    if (Id < Strings.size())
+      return Strings[Id];
+    C.fail();
+    return StringRef();
+  };
+
+  Edge E;
+  int64_t Src = 0;
+  for (unsigned I = 0; I < NumEdges; ++I) {
+    Src += C.readSignedVarint();
+    E.Src = unsigned(Src);
+    E.Dst = unsigned(Src + C.readSignedVarint());
+    E.Text = StringRef();
+    E.Indices.clear();
+    E.PointsTo.clear();
+    E.Consts.clear();
+
+    switch (Kind) {
+    case TextFact:
+      E.Text = getString(C.readVarint());
+      break;
+    case IndexSetFact:
+      if (C.readByte() == ListEncoding) {
+        uint64_t Count = C.readVarint();
+        unsigned Index = 0;
+        for (uint64_t K = 0; K < Count && !C.failed(); ++K) {
+          Index += unsigned(C.readVarint());
+          E.Indices.push_back(Index);
+        }
+      } else {
+        StringRef Bitmap = C.readBytes(C.readVarint());
+        for (unsigned Byte = 0; Byte < Bitmap.size(); ++Byte)
+          for (unsigned Bit = 0; Bit < 8; ++Bit)
+            if (Bitmap.bytes_begin()[Byte] & (1 << Bit))
+              E.Indices.push_back(Byte * 8 + Bit);
+      }
+      break;
+    case PointsToFact: {
+      uint64_t NumKeys = C.readVarint();
+      for (uint64_t K = 0; K < NumKeys && !C.failed(); ++K) {
+        FunctionWriter::Ptr Key = C.readPtr();
+        E.PointsTo.emplace_back(Key, std::vector<FunctionWriter::Ptr>());
+        uint64_t NumTargets = C.readVarint();
+        for (uint64_t T = 0; T < NumTargets && !C.failed(); ++T)
+          E.PointsTo.back().second.push_back(C.readPtr());
+      }
+      break;
+    }
+    case ConstMapFact: {
+      uint64_t NumEntries = C.readVarint();
+      for (uint64_t K = 0; K < NumEntries && !C.failed(); ++K) {
+        Edge::Const Entry;
+        Entry.Name = getString(C.readVarint());
+        Entry.State = ConstState(C.readByte());
+        if (Entry.State == ValueState)
+          Entry.Value = getString(C.readVarint());
+        E.Consts.push_back(Entry);
+      }
+      break;
+    }
+    }
+
+    if (C.failed())
+      return malformed("edge " + Twine(I) + " of " + Name);
+    Callback(E);
+  }
+  return Error::success();
+}
+
+Expected<std::unique_ptr<ResultFile>> ResultFile::open(StringRef Path) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Buffer =
+      MemoryBuffer::getFile(Path, /*IsText=*/false, /*RequiresNullTerminator=*/false);
+  if (!Buffer)
+    return createFileError(Path, Buffer.getError());
+  std::unique_ptr<ResultFile> File(new ResultFile());
+  File->Buffer = std::move(*Buffer);
+  if (Error Err = File->parse())
+    return createFileError(Path, std::move(Err));
+  return File;
+}
+
+Error ResultFile::parse() {
+  StringRef Data = Buffer->getBuffer();
+  std::string Header = getFileHeader();
+  if (!Data.startswith(Header)) {
+    if (Data.startswith(StringRef(Magic, sizeof(Magic))))
+      return malformed("unsupported version");
+    return malformed("not a result file");
+  }
+
+  Cursor C(Data.drop_front(HeaderSize));
+  while (!C.atEnd()) {
+    Cursor Record(C.readString());
+    FunctionRecord F;
+    F.Name = Record.readString();
+    F.Kind = FactKind(Record.readByte());
+    uint64_t NumStrings = Record.readVarint();
+    for (uint64_t I = 0; I < NumStrings && !Record.failed(); ++I)
+      F.Strings.push_back(Record.readString());
+    F.NumEdges = unsigned(Record.readVarint());
+    F.EdgeData = Record.readRest();
+    if (C.failed() || Record.failed() || F.Kind > ConstMapFact)
+      return malformed("function record " + Twine(Functions.size()));
+    Functions.push_back(std::move(F));
+  }
+  for (unsigned I = 0; I < Functions.size(); ++I)
+    FunctionIndex.try_emplace(Functions[I].Name, I);
+  return Error::success();
+}
+
+const FunctionRecord *ResultFile::lookup(StringRef Name) const {
+  auto It = FunctionIndex.find(Name);
+  return It == FunctionIndex.end() ? nullptr : &Functions[It->second];
+}
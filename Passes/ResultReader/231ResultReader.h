@@ -0,0 +1,101 @@
+//===- 231ResultReader.h - Reader of binary CSE 231 results --------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file provides the reader of the binary output of the CSE 231 dataflow
+// analyses, whose format is described in 231ResultFormat.h.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_231RESULTREADER_H
+#define LLVM_TRANSFORMS_231RESULTREADER_H
+
+#include "231ResultFormat.h"
+#include "llvm/ADT/STLFunctionalExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <memory>
+#include <vector>
+
+namespace llvm {
+namespace cse231result {
+
+/*
+ * One decoded edge. Only the members of the fact kind of its function are
+ * filled; strings point into the mapped file.
+ */
+struct Edge {
+  unsigned Src = 0, Dst = 0;
+  StringRef Text;
+  std::vector<unsigned> Indices;
+  std::vector<std::pair<FunctionWriter::Ptr, std::vector<FunctionWriter::Ptr>>> PointsTo;
+  struct Const {
+    StringRef Name;
+    ConstState State;
+    StringRef Value;
+  };
+  std::vector<Const> Consts;
+
+  /*
+   * Print the edge as the analyses print it in the text format.
+   */
+  void print(raw_ostream &OS) const;
+};
+
+/*
+ * The record of one function. Its edges are decoded on demand.
+ */
+class FunctionRecord {
+  public:
+    StringRef getName() const { return Name; }
+    FactKind getKind() const { return Kind; }
+    unsigned getNumEdges() const { return NumEdges; }
+
+    /*
+     * Decode the edges in file order. Stops at the first malformed one.
+     */
+    Error forEachEdge(function_ref<void(const Edge &)> Callback) const;
+
+  private:
+    friend class ResultFile;
+    StringRef Name;
+    FactKind Kind = TextFact;
+    std::vector<StringRef> Strings;
+    unsigned NumEdges = 0;
+    StringRef EdgeData;
+};
+
+/*
+ * A result file, memory mapped. Only the function headers are decoded when
+ * it is opened.
+ */
+class ResultFile {
+  public:
+    static Expected<std::unique_ptr<ResultFile>> open(StringRef Path);
+
+    const std::vector<FunctionRecord> &functions() const { return Functions; }
+
+    /*
+     * The first function of that name, or nullptr.
+     */
+    const FunctionRecord *lookup(StringRef Name) const;
+
+  private:
+    Error parse();
+
+    std::unique_ptr<MemoryBuffer> Buffer;
+    std::vector<FunctionRecord> Functions;
+    StringMap<unsigned> FunctionIndex;
+};
+
+} // namespace cse231result
+} // namespace llvm
+
+#endif
@@ -0,0 +1,103 @@
+//===- cse231-result.cpp - Dump and query binary CSE 231 results ---------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Reads the output of opt -cse231-* -cse231-output-format=binary without
+// running the analyses again:
+//
+//   cse231-result list FILE                   functions, fact kinds and edge counts
+//   cse231-result dump FILE [FUNCTION]        the text output of the analysis
+//   cse231-result query FILE FUNCTION SRC DST the fact of one edge
+//
+//===----------------------------------------------------------------------===//
+
+#include "231ResultReader.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/WithColor.h"
+
+using namespace llvm;
+using namespace llvm::cse231result;
+
+static cl::opt<std::string> Command(cl::Positional, cl::Required, cl::desc("<list|dump|query>"));
+static cl::opt<std::string> InputFile(cl::Positional, cl::Required, cl::desc("<result file>"));
+static cl::list<std::string> Arguments(cl::Positional, cl::ZeroOrMore, cl::desc("[function [src dst]]"));
+
+static const char *getKindName(FactKind Kind) {
+  switch (Kind) {
+  case TextFact:
+    return "text";
+  case IndexSetFact:
+    return "index-set";
+  case PointsToFact:
+    return "points-to";
+  case ConstMapFact:
+    return "const-map";
+  }
+  return "unknown";
+}
+
+static int error(const Twine &Message) {
+  WithColor::error(errs(), "cse231-result") << Message << "\n";
+  return 1;
+}
+
+static int error(Error Err) {
+  std::string Message = toString(std::move(Err));
+  return error(Message);
+}
+
+int main(int argc, char **argv) {
+  InitLLVM X(argc, argv);
+  cl::ParseCommandLineOptions(argc, argv, "CSE 231 binary result reader\n");
+
+  Expected<std::unique_ptr<ResultFile>> File = ResultFile::open(InputFile);
+  if (!File)
+    return error(File.takeError());
+
+  if (Command == "list") {
+    for (const FunctionRecord &F : (*File)->functions())
+      outs() << F.getName() << "\t" << getKindName(F.getKind()) << "\t" << F.getNumEdges() << "\n";
+    return 0;
+  }
+
+  if (Command == "dump") {
+    if (Arguments.size() > 1)
+      return error("dump takes at most one function");
+    for (const FunctionRecord &F : (*File)->functions()) {
+      if (!Arguments.empty() && F.getName() != Arguments[0])
+        continue;
+      if (Error Err = F.forEachEdge([](const Edge &E) { E.print(outs()); }))
+        return error(std::move(Err));
+    }
+    return 0;
+  }
+
+  if (Command == "query") {
+    unsigned Src, Dst;
+    if (Arguments.size() != 3 || StringRef(Arguments[1]).getAsInteger(10, Src) ||
+        StringRef(Arguments[2]).getAsInteger(10, Dst))
+      return error("query takes a function and two instruction indices");
+    const FunctionRecord *F = (*File)->lookup(Arguments[0]);
+    if (!F)
+      return error("no function " + Arguments[0]);
+    bool Found = false;
+    if (Error Err = F->forEachEdge([&](const Edge &E) {
+          if (E.Src == Src && E.Dst == Dst) {
+            E.print(outs());
+            Found = true;
+          }
+        }))
+      return error(std::move(Err));
+    if (!Found)
+      return error("no edge " + Twine(Src) + "->" + Twine(Dst) + " in " + Arguments[0]);
+    return 0;
+  }
+
+  return error("unknown command " + Command);
+}